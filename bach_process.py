@@ -32,4 +32,4 @@ with cd('redes-grandes'):
         else:
             os.system(f'../node_eff_sequential_array {edgelist}')
         # prefix = edgelist.split('.')[0]
-        # os.system(f'../compare-expected-trab-1 {prefix}.eff')
+        # os.system(f'../node_eff_validate {prefix}.eff')
@@ -0,0 +1,1065 @@
+/*
+* @author Roberto Hiroshi Matos Furuta
+* Contact: roberto.furuta@usp.br
+
+* Implementation of the libnodeeff C++ API (see node_eff.h).
+
+* When compiled with -fopenmp, the efficiency of the nodes is calculated in parallel with OpenMP,
+* otherwise it is calculated sequentially.
+*/
+
+#include "node_eff.h"
+
+#include <algorithm> // for min
+#include <climits>   //to use INT_MAX
+#include <exception> // to carry an exception out of the parallel region
+#include <fstream>   // for file mannagement
+#include <iomanip>   // for setting the precision
+#include <numeric>   // for partial_sum and iota
+#include <random>    // for choosing the sampled sources
+#include <sstream>   // for string stream
+#include <stdexcept> // for invalid_argument
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace node_eff
+{
+
+namespace
+{
+
+// num_threads <= 0 means the OpenMP default; without OpenMP the value is not used
+int resolve_num_threads(int num_threads)
+{
+#ifdef _OPENMP
+    if (num_threads <= 0)
+    {
+        num_threads = omp_get_max_threads();
+    }
+#endif
+    return num_threads;
+}
+
+// the breadth first search and the efficiency loop are written once for both graph formats,
+// which only differ in how the neighbours of a node are read
+
+template <typename Visit>
+inline void for_each_neighbour(const Graph &graph, int node, Visit visit)
+{
+    for (int64_t k = graph.offsets[node]; k < graph.offsets[node + 1]; k++) // for each neighbour
+    // here we have spacial locality by accessing the neighbours, allocated sequentially
+    {
+        visit(graph.neighbours[k]);
+    }
+}
+
+template <typename Visit>
+inline void for_each_neighbour(const CompressedGraph &graph, int node, Visit visit)
+{
+    NeighbourDecoder decoder(graph, node); // the neighbours are decoded as they are read
+    int neighbour;
+    while (decoder.next(neighbour))
+    {
+        visit(neighbour);
+    }
+}
+
+// the search stops after the nodes at distance max_depth are found (INT_MAX for the whole component)
+template <typename GraphType>
+void search(const GraphType &graph, int src, BfsWorkspace &workspace, int max_depth = INT_MAX)
+{
+    vector<int> &dist = workspace.dist;
+    vector<int> &queue = workspace.queue; // vector of sequence of nodes to evaluate
+
+    // only the nodes reached by the previous search have to be cleared,
+    // which is cheaper than allocating a new dist vector for every source
+    for (int k = 0; k < workspace.reached; k++)
+    {
+        dist[queue[k]] = INT_MAX;
+    }
+    workspace.level_count.assign(1, 1); // the source itself, at distance 0
+
+    int pos = 0;        // the position in queue of the next node to evaluate
+    int next_empty = 1; // the position in the queue to which a new node will be added
+
+    // updating the first node: src
+    dist[src] = 0;
+    queue[0] = src;
+
+    // a node is visited if dist[node] != INT_MAX, so no separate visited vector is needed
+    while (pos < next_empty) // while there are nodes in the queue which were not evaluated yet
+    {
+        int node = queue[pos]; // the first node is chosen
+        pos += 1;              // and it is removed from the queue
+
+        if (dist[node] >= max_depth) // the nodes left in the queue are all at max_depth, their neighbours are not needed
+        {
+            break;
+        }
+        int next_dist = dist[node] + 1;
+        for_each_neighbour(graph, node, [&](int neighbour) {
+            if (dist[neighbour] == INT_MAX) // if it's not been visited:
+            {
+                dist[neighbour] = next_dist;   // +1 step distance to the neighbour
+                queue[next_empty] = neighbour; // add to the queue
+                next_empty += 1;               // update the next empty position
+
+                if (next_dist == (int)workspace.level_count.size()) // first node of a new level
+                {
+                    workspace.level_count.push_back(0);
+                }
+                workspace.level_count[next_dist] += 1;
+            }
+        });
+    }
+    workspace.reached = next_empty;
+}
+
+// levels, if given, gets the level_count of every source
+template <typename GraphType>
+void efficiency_of_range(const GraphType &graph, int first_node, int count, int num_threads, double *eff,
+                         int max_depth = INT_MAX, const vector<int> *component_size = nullptr,
+                         vector<vector<int64_t>> *levels = nullptr)
+{
+    if (first_node < 0 || count < 0 || count > graph.N - first_node) // (first_node + count could overflow)
+    {
+        throw invalid_argument("the range of nodes is not inside the graph");
+    }
+    num_threads = resolve_num_threads(num_threads);
+    if (levels != nullptr)
+    {
+        levels->assign(count, vector<int64_t>());
+    }
+
+// PARALLEL IMPLEMENTATION WITH OMP
+// graph: read only
+// eff: to write the eff values on. It's expected that the pre-implemented "omp for" protocol will split the range of the for into
+// well distribuited continuous chuncks, minimizing the false sharing of this object.
+// each thread has its own workspace, allocated once and reused for all of its nodes.
+#pragma omp parallel default(none) shared(graph, first_node, count, eff, max_depth, component_size, levels) num_threads(num_threads)
+    {
+        BfsWorkspace workspace(graph.N);
+#pragma omp for
+        for (int i = first_node; i < first_node + count; i++) // for every node:
+        {
+            search(graph, i, workspace, max_depth);
+            eff[i - first_node] = efficiency_from_levels(workspace.level_count, graph.N);
+            int unreached = component_size != nullptr ? (*component_size)[i] - workspace.reached : 0;
+            if (unreached > 0) // tail estimate of the truncated efficiency
+            {
+                eff[i - first_node] += (double)unreached / (max_depth + 1) / (graph.N - 1);
+            }
+            if (levels != nullptr)
+            {
+                (*levels)[i - first_node] = workspace.level_count;
+            }
+        }
+    }
+}
+
+template <typename GraphType>
+void efficiency_of_batches(const GraphType &graph, int num_threads, int batch_size, const BatchCallback &callback)
+{
+    if (batch_size <= 0)
+    {
+        throw invalid_argument("batch_size must be positive");
+    }
+    num_threads = resolve_num_threads(num_threads);
+
+    vector<double> batch(min(batch_size, max(graph.N, 1))); // efficiencies of the current batch
+    exception_ptr error;                                     // exception thrown by the callback, if any
+
+// a single parallel region is used for all the batches, so the workspaces are allocated only once.
+// the batch is calculated by all the threads and then handed to the callback by one of them,
+// the barriers at the end of "omp for" and "omp single" keep the batches in order.
+#pragma omp parallel default(none) shared(graph, batch_size, callback, batch, error) num_threads(num_threads)
+    {
+        BfsWorkspace workspace(graph.N);
+        for (int first = 0; first < graph.N; first += batch_size) // every thread goes through all the batches
+        {
+            int count = min(batch_size, graph.N - first);
+#pragma omp for
+            for (int i = first; i < first + count; i++)
+            {
+                search(graph, i, workspace);
+                batch[i - first] = efficiency_from_levels(workspace.level_count, graph.N);
+            }
+#pragma omp single
+            {
+                try
+                {
+                    callback(first, count, batch.data());
+                }
+                catch (...)
+                {
+                    error = current_exception();
+                }
+            }
+            if (error) // every thread sees it after the barrier of "omp single"
+            {
+                break;
+            }
+        }
+    }
+    if (error)
+    {
+        rethrow_exception(error);
+    }
+}
+
+template <typename GraphType>
+vector<int> sizes_of_components(const GraphType &graph)
+{
+    vector<int> size(graph.N, 0); // 0 while the component of the node is not known
+    BfsWorkspace workspace(graph.N);
+    for (int i = 0; i < graph.N; i++)
+    {
+        if (size[i] == 0) // the first node found of a new component
+        {
+            search(graph, i, workspace);
+            for (int k = 0; k < workspace.reached; k++) // every node reached is in the same component
+            {
+                size[workspace.queue[k]] = workspace.reached;
+            }
+        }
+    }
+    return size;
+}
+
+template <typename GraphType>
+void truncated_efficiency_of_range(const GraphType &graph, int first_node, int count, int num_threads, int max_depth,
+                                   bool tail_estimate, double *eff)
+{
+    if (max_depth < 1)
+    {
+        throw invalid_argument("max_depth must be at least 1");
+    }
+    vector<int> component_size;
+    if (tail_estimate)
+    {
+        component_size = sizes_of_components(graph);
+    }
+    efficiency_of_range(graph, first_node, count, num_threads, eff, max_depth, tail_estimate ? &component_size : nullptr);
+}
+
+// sorts the neighbours [begin, end) of node and appends them to bytes in the format of CompressedGraph
+void encode_neighbours(int node, int *begin, int *end, vector<uint8_t> &bytes)
+{
+    auto write_varint = [&](uint32_t value) {
+        while (value >= 0x80)
+        {
+            bytes.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back((uint8_t)value);
+    };
+
+    sort(begin, end);
+    for (int *neighbour = begin; neighbour != end; neighbour++)
+    {
+        if (neighbour == begin)
+        {
+            int64_t difference = (int64_t)*neighbour - node; // zigzag, as decoded by NeighbourDecoder
+            write_varint(difference >= 0 ? (uint32_t)(2 * difference) : (uint32_t)(-2 * difference - 1));
+        }
+        else
+        {
+            write_varint(*neighbour - *(neighbour - 1));
+        }
+    }
+}
+
+} // namespace
+
+Graph graph_from_edges(int N, const int *edges, size_t num_edges)
+{
+    if (N < 0)
+    {
+        throw invalid_argument("the number of nodes can't be negative");
+    }
+
+    Graph graph;
+    graph.N = N;
+    graph.offsets.assign(N + 1, 0);
+
+    // firstly, the degree of every node is counted (shifted by one position),
+    for (size_t e = 0; e < 2 * num_edges; e++)
+    {
+        if (edges[e] < 0 || edges[e] >= N)
+        {
+            throw invalid_argument("node " + to_string(edges[e]) + " is not in [0, " + to_string(N) + ")");
+        }
+        graph.offsets[edges[e] + 1] += 1;
+    }
+    // then the degrees are summed to get the position where the neighbours of each node start
+    partial_sum(graph.offsets.begin(), graph.offsets.end(), graph.offsets.begin());
+
+    // finally the neighbours are placed, in the same order as adj_list[src].push_back(dest); adj_list[dest].push_back(src);
+    graph.neighbours.resize(graph.offsets[N]);
+    vector<int64_t> next(graph.offsets.begin(), graph.offsets.end() - 1); // next free position of each node
+    for (size_t e = 0; e < num_edges; e++)
+    {
+        int src = edges[2 * e];
+        int dest = edges[2 * e + 1];
+        graph.neighbours[next[src]++] = dest;
+        graph.neighbours[next[dest]++] = src;
+    }
+    return graph;
+}
+
+Graph graph_from_csr(int N, const int64_t *offsets, const int *neighbours)
+{
+    if (N < 0)
+    {
+        throw invalid_argument("the number of nodes can't be negative");
+    }
+    if (offsets[0] != 0)
+    {
+        throw invalid_argument("offsets[0] must be 0");
+    }
+
+    Graph graph;
+    graph.N = N;
+    graph.offsets.assign(offsets, offsets + N + 1);
+    for (int i = 0; i < N; i++)
+    {
+        if (offsets[i + 1] < offsets[i])
+        {
+            throw invalid_argument("offsets must be non decreasing");
+        }
+    }
+
+    graph.neighbours.assign(neighbours, neighbours + offsets[N]);
+    for (int neighbour : graph.neighbours)
+    {
+        if (neighbour < 0 || neighbour >= N)
+        {
+            throw invalid_argument("node " + to_string(neighbour) + " is not in [0, " + to_string(N) + ")");
+        }
+    }
+    return graph;
+}
+
+CompressedGraph compress(const Graph &graph)
+{
+    CompressedGraph compressed;
+    compressed.N = graph.N;
+    compressed.offsets.assign(graph.N + 1, 0);
+    compressed.num_neighbours = graph.neighbours.size();
+    compressed.bytes.reserve(graph.neighbours.size() + graph.N); // a bit more than one byte per neighbour is the usual
+
+    vector<int> sorted; // the neighbours of one node, sorted
+    for (int i = 0; i < graph.N; i++)
+    {
+        compressed.offsets[i] = compressed.bytes.size();
+        sorted.assign(graph.neighbours.begin() + graph.offsets[i], graph.neighbours.begin() + graph.offsets[i + 1]);
+        encode_neighbours(i, sorted.data(), sorted.data() + sorted.size(), compressed.bytes);
+    }
+    compressed.offsets[graph.N] = compressed.bytes.size();
+    compressed.bytes.shrink_to_fit();
+    return compressed;
+}
+
+CompressedGraph compressed_graph_from_edges(int N, const int *edges, size_t num_edges)
+{
+    if (N < 0)
+    {
+        throw invalid_argument("the number of nodes can't be negative");
+    }
+
+    // the position where the neighbours of each node would start in the CSR, as in graph_from_edges
+    vector<int64_t> start(N + 1, 0);
+    for (size_t e = 0; e < 2 * num_edges; e++)
+    {
+        if (edges[e] < 0 || edges[e] >= N)
+        {
+            throw invalid_argument("node " + to_string(edges[e]) + " is not in [0, " + to_string(N) + ")");
+        }
+        start[edges[e] + 1] += 1;
+    }
+    partial_sum(start.begin(), start.end(), start.begin());
+
+    CompressedGraph compressed;
+    compressed.N = N;
+    compressed.offsets.assign(N + 1, 0);
+    compressed.num_neighbours = start[N];
+
+    // the nodes are compressed in blocks of consecutive nodes with at most ~1/8 of all the neighbours:
+    // the edges are read once per block, and only the neighbours of the block are held uncompressed.
+    // the blocks are made twice: the first time only to find the size of the bytes of each node, so the bytes
+    // are allocated once with their final size instead of being copied to a larger vector as they grow
+    int64_t budget = max<int64_t>(start[N] / 8, 1 << 20);
+    vector<int> block;    // the neighbours of the nodes of the block, node after node
+    vector<int64_t> next; // next free position in block of each node of the block
+    vector<uint8_t> scratch;
+    auto for_each_block = [&](auto &&encode_block) {
+        for (int first = 0; first < N;)
+        {
+            int last = first + 1; // the block is first ... last - 1
+            while (last < N && start[last + 1] - start[first] <= budget)
+            {
+                last++;
+            }
+            block.resize(start[last] - start[first]);
+            next.assign(start.begin() + first, start.begin() + last);
+            for (int64_t &position : next)
+            {
+                position -= start[first];
+            }
+            for (size_t e = 0; e < num_edges; e++)
+            {
+                int src = edges[2 * e];
+                int dest = edges[2 * e + 1];
+                if (src >= first && src < last)
+                {
+                    block[next[src - first]++] = dest;
+                }
+                if (dest >= first && dest < last)
+                {
+                    block[next[dest - first]++] = src;
+                }
+            }
+            for (int i = first; i < last; i++)
+            {
+                encode_block(i, block.data() + (start[i] - start[first]), block.data() + (start[i + 1] - start[first]));
+            }
+            first = last;
+        }
+    };
+
+    for_each_block([&](int i, int *begin, int *end) {
+        scratch.clear();
+        encode_neighbours(i, begin, end, scratch);
+        compressed.offsets[i + 1] = compressed.offsets[i] + scratch.size();
+    });
+    compressed.bytes.reserve(compressed.offsets[N]);
+    for_each_block([&](int i, int *begin, int *end) { encode_neighbours(i, begin, end, compressed.bytes); });
+    return compressed;
+}
+
+BfsWorkspace::BfsWorkspace(int N) : dist(N, INT_MAX), queue(N)
+{
+}
+
+void breadth_first_search(const Graph &graph, int src, BfsWorkspace &workspace)
+{
+    search(graph, src, workspace);
+}
+
+void breadth_first_search(const CompressedGraph &graph, int src, BfsWorkspace &workspace)
+{
+    search(graph, src, workspace);
+}
+
+double efficiency_from_levels(const vector<int64_t> &level_count, int N)
+{
+    double eff(0);
+    for (size_t d = 1; d < level_count.size(); d++) // the source itself (d = 0) and the isolated nodes don't contribute
+    {
+        eff += (double)level_count[d] / d / (N - 1);
+    }
+    return eff;
+}
+
+double node_efficiency(const Graph &graph, int src, BfsWorkspace &workspace)
+{
+    breadth_first_search(graph, src, workspace);
+    return efficiency_from_levels(workspace.level_count, graph.N);
+}
+
+void efficiency(const Graph &graph, int first_node, int count, int num_threads, double *eff)
+{
+    efficiency_of_range(graph, first_node, count, num_threads, eff);
+}
+
+void efficiency(const CompressedGraph &graph, int first_node, int count, int num_threads, double *eff)
+{
+    efficiency_of_range(graph, first_node, count, num_threads, eff);
+}
+
+void efficiency_and_levels(const Graph &graph, int first_node, int count, int num_threads, double *eff,
+                           vector<vector<int64_t>> &levels)
+{
+    efficiency_of_range(graph, first_node, count, num_threads, eff, INT_MAX, nullptr, &levels);
+}
+
+void efficiency_and_levels(const CompressedGraph &graph, int first_node, int count, int num_threads, double *eff,
+                           vector<vector<int64_t>> &levels)
+{
+    efficiency_of_range(graph, first_node, count, num_threads, eff, INT_MAX, nullptr, &levels);
+}
+
+void truncated_efficiency(const Graph &graph, int first_node, int count, int num_threads, int max_depth, bool tail_estimate, double *eff)
+{
+    truncated_efficiency_of_range(graph, first_node, count, num_threads, max_depth, tail_estimate, eff);
+}
+
+void truncated_efficiency(const CompressedGraph &graph, int first_node, int count, int num_threads, int max_depth, bool tail_estimate, double *eff)
+{
+    truncated_efficiency_of_range(graph, first_node, count, num_threads, max_depth, tail_estimate, eff);
+}
+
+vector<double> efficiency(const Graph &graph, int num_threads)
+{
+    vector<double> eff_list(graph.N, 0); // stores the efficiency of each node
+    efficiency(graph, 0, graph.N, num_threads, eff_list.data());
+    return eff_list;
+}
+
+vector<double> efficiency(const CompressedGraph &graph, int num_threads)
+{
+    vector<double> eff_list(graph.N, 0); // stores the efficiency of each node
+    efficiency(graph, 0, graph.N, num_threads, eff_list.data());
+    return eff_list;
+}
+
+void efficiency_batches(const Graph &graph, int num_threads, int batch_size, const BatchCallback &callback)
+{
+    efficiency_of_batches(graph, num_threads, batch_size, callback);
+}
+
+void efficiency_batches(const CompressedGraph &graph, int num_threads, int batch_size, const BatchCallback &callback)
+{
+    efficiency_of_batches(graph, num_threads, batch_size, callback);
+}
+
+vector<int> component_sizes(const Graph &graph)
+{
+    return sizes_of_components(graph);
+}
+
+vector<int> component_sizes(const CompressedGraph &graph)
+{
+    return sizes_of_components(graph);
+}
+
+namespace
+{
+
+// memory reused by consecutive multi source searches of the same thread
+struct MultiSourceWorkspace
+{
+    vector<uint64_t> seen;      // bit k of seen[node] is set once the search from the k-th source has reached node
+    vector<uint64_t> frontier;  // the searches that reached the node at the last level (only valid for the nodes of frontier_nodes)
+    vector<uint64_t> next;      // the searches that reach the node at the next level; 0 for every node between levels
+    vector<int> frontier_nodes; // the nodes reached at the last level
+    vector<int> next_nodes;     // the nodes reached at the next level
+
+    explicit MultiSourceWorkspace(int N) : seen(N), frontier(N), next(N, 0) {}
+};
+
+// breadth first searches from up to 64 sources at once, one bit of each mask for each source.
+// the neighbours of a node are read once per level for all the searches that have it in their frontier,
+// instead of once for each search, which is where most of the time of a search goes.
+// reached(node, bits, level) is called when the searches in bits reach node, at distance level.
+template <typename GraphType, typename Reached>
+void multi_source_search(const GraphType &graph, const int *sources, int count, MultiSourceWorkspace &workspace, Reached reached)
+{
+    vector<uint64_t> &seen = workspace.seen;
+    vector<uint64_t> &frontier = workspace.frontier;
+    vector<uint64_t> &next = workspace.next;
+
+    fill(seen.begin(), seen.end(), 0);
+    workspace.frontier_nodes.clear();
+    for (int k = 0; k < count; k++) // the same node may be the source of several searches
+    {
+        int src = sources[k];
+        if (seen[src] == 0)
+        {
+            workspace.frontier_nodes.push_back(src);
+            frontier[src] = 0;
+        }
+        seen[src] |= uint64_t(1) << k;
+        frontier[src] |= uint64_t(1) << k;
+    }
+
+    for (int level = 1; !workspace.frontier_nodes.empty(); level++)
+    {
+        workspace.next_nodes.clear();
+        for (int node : workspace.frontier_nodes)
+        {
+            uint64_t bits = frontier[node];
+            for_each_neighbour(graph, node, [&](int neighbour) {
+                uint64_t arriving = bits & ~seen[neighbour]; // the searches that haven't reached the neighbour yet
+                if (arriving != 0)
+                {
+                    if (next[neighbour] == 0)
+                    {
+                        workspace.next_nodes.push_back(neighbour);
+                    }
+                    next[neighbour] |= arriving;
+                }
+            });
+        }
+        for (int node : workspace.next_nodes)
+        {
+            uint64_t bits = next[node];
+            next[node] = 0;
+            seen[node] |= bits;
+            frontier[node] = bits;
+            reached(node, bits, level);
+        }
+        swap(workspace.frontier_nodes, workspace.next_nodes);
+    }
+}
+
+// calls visit(k) for every bit k set in bits
+template <typename Visit>
+inline void for_each_bit(uint64_t bits, Visit visit)
+{
+    for (; bits != 0; bits &= bits - 1) // clears the lowest bit set
+    {
+        visit(__builtin_ctzll(bits));
+    }
+}
+
+void check_sources(int N, const int *sources, int count)
+{
+    if (count < 0)
+    {
+        throw invalid_argument("the number of sources can't be negative");
+    }
+    for (int k = 0; k < count; k++)
+    {
+        if (sources[k] < 0 || sources[k] >= N)
+        {
+            throw invalid_argument("source " + to_string(sources[k]) + " is not in [0, N)");
+        }
+    }
+}
+
+// the sources are split in groups of 64, each group calculated by one multi source search.
+// sums, if given, gets the sum of 1 / distance from the sources of every node (sums[node] over all the groups)
+template <typename GraphType>
+void efficiency_of_sources(const GraphType &graph, const int *sources, int count, int num_threads, double *eff,
+                           vector<double> *sums = nullptr)
+{
+    check_sources(graph.N, sources, count);
+    num_threads = resolve_num_threads(num_threads);
+    int num_groups = (count + 63) / 64;
+    if (sums != nullptr)
+    {
+        sums->assign(graph.N, 0);
+    }
+
+#pragma omp parallel default(none) shared(graph, sources, count, eff, sums, num_groups) num_threads(num_threads)
+    {
+        MultiSourceWorkspace workspace(graph.N);
+        vector<double> thread_sums(sums != nullptr ? graph.N : 0, 0);
+        int64_t found[64]; // found[k]: nodes reached by the k-th search of the group at the current level
+
+#pragma omp for schedule(dynamic)
+        for (int group = 0; group < num_groups; group++)
+        {
+            int first = group * 64;
+            int size = min(64, count - first);
+            double *group_eff = eff + first;
+            fill(group_eff, group_eff + size, 0);
+            fill(found, found + 64, 0);
+
+            // adds the nodes found at one level, as in efficiency_from_levels (so the result is exactly the same)
+            int current_level = 1;
+            auto add_level = [&]() {
+                for (int k = 0; k < size; k++)
+                {
+                    if (found[k] > 0)
+                    {
+                        group_eff[k] += (double)found[k] / current_level / (graph.N - 1);
+                        found[k] = 0;
+                    }
+                }
+            };
+            multi_source_search(graph, sources + first, size, workspace, [&](int node, uint64_t bits, int level) {
+                if (level != current_level)
+                {
+                    add_level();
+                    current_level = level;
+                }
+                for_each_bit(bits, [&](int k) { found[k]++; });
+                if (sums != nullptr)
+                {
+                    thread_sums[node] += (double)__builtin_popcountll(bits) / level;
+                }
+            });
+            add_level();
+        }
+
+        if (sums != nullptr)
+        {
+#pragma omp critical
+            for (int i = 0; i < graph.N; i++)
+            {
+                (*sums)[i] += thread_sums[i];
+            }
+        }
+    }
+}
+
+// the sources are num_samples nodes chosen at random without repetition. A node that was not chosen
+// is at the same position as any other node, so the mean of 1 / distance from the chosen nodes
+// is an unbiased estimate of the mean over all the other nodes, which is its efficiency.
+template <typename GraphType>
+vector<double> sampled_efficiency_of(const GraphType &graph, int num_samples, uint64_t seed, int num_threads)
+{
+    if (num_samples < 1)
+    {
+        throw invalid_argument("num_samples must be at least 1");
+    }
+    num_samples = min(num_samples, graph.N);
+
+    vector<int> sources(graph.N); // the first num_samples nodes of a random permutation
+    iota(sources.begin(), sources.end(), 0);
+    mt19937_64 random(seed);
+    for (int k = 0; k < num_samples; k++)
+    {
+        swap(sources[k], sources[uniform_int_distribution<int>(k, graph.N - 1)(random)]);
+    }
+    sources.resize(num_samples);
+
+    vector<double> exact(num_samples), sums;
+    efficiency_of_sources(graph, sources.data(), num_samples, num_threads, exact.data(), &sums);
+
+    vector<double> eff_list(graph.N);
+    for (int i = 0; i < graph.N; i++)
+    {
+        eff_list[i] = sums[i] / num_samples;
+    }
+    for (int k = 0; k < num_samples; k++) // the efficiency of the chosen nodes is known exactly
+    {
+        eff_list[sources[k]] = exact[k];
+    }
+    return eff_list;
+}
+
+} // namespace
+
+void efficiency_of_nodes(const Graph &graph, const int *nodes, int count, int num_threads, double *eff)
+{
+    efficiency_of_sources(graph, nodes, count, num_threads, eff);
+}
+
+void efficiency_of_nodes(const CompressedGraph &graph, const int *nodes, int count, int num_threads, double *eff)
+{
+    efficiency_of_sources(graph, nodes, count, num_threads, eff);
+}
+
+vector<double> sampled_efficiency(const Graph &graph, int num_samples, uint64_t seed, int num_threads)
+{
+    return sampled_efficiency_of(graph, num_samples, seed, num_threads);
+}
+
+vector<double> sampled_efficiency(const CompressedGraph &graph, int num_samples, uint64_t seed, int num_threads)
+{
+    return sampled_efficiency_of(graph, num_samples, seed, num_threads);
+}
+
+namespace
+{
+
+// a bounded search is abandoned only if its upper bound is below the threshold by more than
+// the rounding error, so a node whose exact efficiency reaches the threshold is never pruned
+bool below(double upper_bound, double threshold)
+{
+    return upper_bound < threshold - 1e-12 * threshold;
+}
+
+// breadth first search from src done level by level, which stops as soon as the efficiency of src
+// can't reach threshold. Before each level is expanded, the upper bound of the efficiency is:
+// the exact contribution of the levels already found, plus the remaining nodes of the component placed
+// as close as possible: at most "sum of degrees of the last level" of them at the next level, the rest after it.
+// returns false if the search was stopped, otherwise eff is the exact efficiency of src.
+bool bounded_node_efficiency(const Graph &graph, int src, int component_size, double threshold,
+                             BfsWorkspace &workspace, double &eff)
+{
+    vector<int> &dist = workspace.dist;
+    vector<int> &queue = workspace.queue;
+    for (int k = 0; k < workspace.reached; k++)
+    {
+        dist[queue[k]] = INT_MAX;
+    }
+    workspace.level_count.assign(1, 1);
+
+    dist[src] = 0;
+    queue[0] = src;
+    int level = 0;       // distance of the nodes in queue[level_start .. next_empty - 1]
+    int level_start = 0; // position in the queue of the first node of the current level
+    int next_empty = 1;  // the position in the queue to which a new node will be added
+    eff = 0;
+
+    while (level_start < next_empty)
+    {
+        int remaining = component_size - next_empty; // nodes of the component not reached yet
+        if (remaining == 0)
+        {
+            break;
+        }
+
+        // every node of the current level (except the source) uses at least one edge to reach its parent
+        int64_t next_level_max = 0;
+        for (int k = level_start; k < next_empty; k++)
+        {
+            next_level_max += graph.degree(queue[k]) - (level > 0 ? 1 : 0);
+        }
+        int64_t nearest = min<int64_t>(remaining, next_level_max);
+        double upper_bound = eff + (double)nearest / (level + 1) / (graph.N - 1) +
+                             (double)(remaining - nearest) / (level + 2) / (graph.N - 1);
+        if (below(upper_bound, threshold))
+        {
+            workspace.reached = next_empty;
+            return false;
+        }
+
+        // the current level is expanded
+        int level_end = next_empty;
+        for (int k = level_start; k < level_end; k++)
+        {
+            int node = queue[k];
+            for (int64_t e = graph.offsets[node]; e < graph.offsets[node + 1]; e++)
+            {
+                int neighbour = graph.neighbours[e];
+                if (dist[neighbour] == INT_MAX) // if it's not been visited:
+                {
+                    dist[neighbour] = level + 1;
+                    queue[next_empty] = neighbour;
+                    next_empty += 1;
+                }
+            }
+        }
+        level += 1;
+        level_start = level_end;
+        if (next_empty > level_end)
+        {
+            workspace.level_count.push_back(next_empty - level_end);
+            eff += (double)(next_empty - level_end) / level / (graph.N - 1); // same sum as in efficiency_from_levels
+        }
+    }
+    workspace.reached = next_empty;
+    return true;
+}
+
+// shared implementation of top_k (k > 0) and above_threshold (k == 0)
+vector<NodeEfficiency> bounded_query(const Graph &graph, int k, double threshold, int num_threads, QueryStats *stats)
+{
+    int N = graph.N;
+    num_threads = resolve_num_threads(num_threads);
+    vector<int> component_size = component_sizes(graph);
+
+    // bounds from the degrees, before any search: with d distinct neighbours at distance 1, the efficiency is
+    // at most "the other nodes of the component at distance 2" and at least "the other nodes in a chain, at 2, 3, 4, ..."
+    vector<double> harmonic(N + 1, 0); // harmonic[n] = 1 + 1/2 + ... + 1/n
+    for (int n = 1; n <= N; n++)
+    {
+        harmonic[n] = harmonic[n - 1] + 1. / n;
+    }
+    vector<double> upper(N, 0), lower(N, 0);
+    vector<int> stamp(N, -1); // stamp[j] == i if j was already counted as a neighbour of i
+    for (int i = 0; i < N; i++)
+    {
+        int distinct = 0; // neighbours without repeated edges and self loops
+        for (int64_t e = graph.offsets[i]; e < graph.offsets[i + 1]; e++)
+        {
+            int neighbour = graph.neighbours[e];
+            if (neighbour != i && stamp[neighbour] != i)
+            {
+                stamp[neighbour] = i;
+                distinct += 1;
+            }
+        }
+        int others = component_size[i] - 1 - distinct; // nodes at distance 2 or more
+        if (N > 1)
+        {
+            upper[i] = (distinct + others / 2.) / (N - 1);
+            lower[i] = (distinct + harmonic[others + 1] - 1) / (N - 1);
+        }
+    }
+
+    // for top_k, the k-th largest lower bound is already a lower bound of the k-th largest efficiency
+    k = min(k, N);
+    if (k > 0)
+    {
+        vector<double> sorted_lower(lower);
+        nth_element(sorted_lower.begin(), sorted_lower.begin() + (k - 1), sorted_lower.end(), greater<double>());
+        threshold = sorted_lower[k - 1];
+    }
+
+    // the candidates are processed from the largest upper bound, so the k-th efficiency found rises quickly
+    // and the candidates left at the end are the ones most likely to be skipped
+    vector<int> candidates;
+    for (int i = 0; i < N; i++)
+    {
+        if (!below(upper[i], threshold))
+        {
+            candidates.push_back(i);
+        }
+    }
+    sort(candidates.begin(), candidates.end(), [&](int a, int b) { return upper[a] > upper[b] || (upper[a] == upper[b] && a < b); });
+
+    // for top_k, a min-heap with the k largest efficiencies found so far
+    auto heap_order = [](const NodeEfficiency &a, const NodeEfficiency &b) { return a.eff > b.eff; };
+    vector<NodeEfficiency> found;
+    int64_t skipped = N - (int64_t)candidates.size(), pruned = 0, completed = 0;
+    int num_candidates = candidates.size();
+
+// the candidates are split dynamically, since the cost of each one depends on how early it is pruned.
+// threshold only grows, and a thread reading an older value just prunes less.
+#pragma omp parallel default(none) shared(graph, k, threshold, candidates, num_candidates, component_size, upper, found, heap_order) \
+    reduction(+ : skipped, pruned, completed) num_threads(num_threads)
+    {
+        BfsWorkspace workspace(graph.N);
+#pragma omp for schedule(dynamic, 1)
+        for (int c = 0; c < num_candidates; c++)
+        {
+            int i = candidates[c];
+            double current_threshold;
+#pragma omp atomic read
+            current_threshold = threshold;
+
+            double eff;
+            if (below(upper[i], current_threshold))
+            {
+                skipped += 1;
+            }
+            else if (!bounded_node_efficiency(graph, i, component_size[i], current_threshold, workspace, eff))
+            {
+                pruned += 1;
+            }
+            else
+            {
+                completed += 1;
+#pragma omp critical(node_eff_query)
+                {
+                    if (k == 0) // above_threshold
+                    {
+                        if (eff >= threshold)
+                        {
+                            found.push_back({i, eff});
+                        }
+                    }
+                    else if ((int)found.size() < k || eff > found.front().eff) // top_k
+                    {
+                        found.push_back({i, eff});
+                        push_heap(found.begin(), found.end(), heap_order);
+                        if ((int)found.size() > k)
+                        {
+                            pop_heap(found.begin(), found.end(), heap_order);
+                            found.pop_back();
+                        }
+                        if ((int)found.size() == k && found.front().eff > threshold)
+                        {
+#pragma omp atomic write
+                            threshold = found.front().eff;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    sort(found.begin(), found.end(), [](const NodeEfficiency &a, const NodeEfficiency &b) {
+        return a.eff > b.eff || (a.eff == b.eff && a.node < b.node);
+    });
+    if (stats != nullptr)
+    {
+        stats->skipped = skipped;
+        stats->pruned = pruned;
+        stats->completed = completed;
+    }
+    return found;
+}
+
+} // namespace
+
+vector<NodeEfficiency> top_k(const Graph &graph, int k, int num_threads, QueryStats *stats)
+{
+    if (k < 0)
+    {
+        throw invalid_argument("k can't be negative");
+    }
+    if (k == 0)
+    {
+        if (stats != nullptr)
+        {
+            *stats = QueryStats{};
+        }
+        return {};
+    }
+    return bounded_query(graph, k, 0, num_threads, stats);
+}
+
+vector<NodeEfficiency> above_threshold(const Graph &graph, double threshold, int num_threads, QueryStats *stats)
+{
+    return bounded_query(graph, 0, threshold, num_threads, stats);
+}
+
+int node_count_from_filename(const string &filename)
+{
+    vector<string> split_file_name;
+    stringstream s_stream(filename); // string stream object
+    while (s_stream.good())
+    {
+        string substr;
+        getline(s_stream, substr, '_'); // splits the filename at "_"
+        split_file_name.push_back(substr);
+    }
+    if (split_file_name.size() < 3)
+    {
+        throw invalid_argument("the file name " + filename + " is not in the format ???_n_'N'_k_'?_?'.edgelist");
+    }
+    return stoi(split_file_name[2]); // the N is the [2]th element
+}
+
+string output_prefix(const string &filename)
+{
+    size_t pos = filename.find(".edgelist");
+    return filename.substr(0, pos);
+}
+
+vector<int> read_edgelist(istream &file)
+{
+    vector<int> flat_edgelist;
+    string line;
+    while (getline(file, line)) // for each line in the edgelist file,
+    {
+        int src, dest;
+        istringstream ss(line);
+        if (ss >> src >> dest) // the src (source) and dest (destination) node pair (edge) is read
+        {
+            flat_edgelist.push_back(src);
+            flat_edgelist.push_back(dest);
+        }
+    }
+    return flat_edgelist;
+}
+
+void write_eff(const string &output_file, const vector<double> &eff_list)
+{
+    ofstream myfile(output_file);
+    myfile << setprecision(6) << fixed; // set 6 decimal places
+    for (double eff : eff_list)
+    {
+        myfile << eff << '\n';
+    }
+}
+
+void write_query(const string &output_file, const vector<NodeEfficiency> &answer)
+{
+    ofstream myfile(output_file);
+    myfile << setprecision(6) << fixed; // set 6 decimal places
+    for (const NodeEfficiency &found : answer)
+    {
+        myfile << found.node << ' ' << found.eff << '\n';
+    }
+}
+
+void write_time(const string &output_time, double elapsed_seconds)
+{
+    ofstream timefile(output_time);
+    timefile << setprecision(6) << fixed; // set 6 decimal places
+    timefile << elapsed_seconds << endl;
+}
+
+} // namespace node_eff
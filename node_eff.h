@@ -0,0 +1,306 @@
+/*
+* @author Roberto Hiroshi Matos Furuta
+* Contact: roberto.furuta@usp.br
+
+* libnodeeff: the node efficiency (https://en.wikipedia.org/wiki/Efficiency_(network_science))
+* engine used by the node_eff_* programs, packaged as a library so that it can be called
+* with an in-memory graph, without writing an .edgelist file and reading back an .eff file.
+
+* The graph is stored in the compressed sparse row (CSR) format: the neighbours of every node
+* are stored one after the other in a single vector, and offsets[i] is the position in which the
+* neighbours of node i start. It holds the same data as the adjacency list (vector of vector of int)
+* used before, but in one contiguous block of memory.
+
+* This is the C++ API. The stable C ABI, for use from C or from other languages (e.g. Python ctypes),
+* is declared in node_eff_c.h.
+*/
+
+#ifndef NODE_EFF_H
+#define NODE_EFF_H
+
+#include <cstddef>    // for size_t
+#include <cstdint>    // for int64_t
+#include <functional> // for the batch callback
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace node_eff
+{
+
+// undirected graph in the CSR format.
+// every edge is stored twice, once in each direction, as in the adjacency list.
+struct Graph
+{
+    int N = 0;                       // number of nodes
+    std::vector<int64_t> offsets;    // N + 1 positions: the neighbours of node i are neighbours[offsets[i]] ... neighbours[offsets[i + 1] - 1]
+    std::vector<int> neighbours;     // the neighbours of all the nodes, node after node
+
+    int64_t degree(int node) const { return offsets[node + 1] - offsets[node]; }
+    size_t memory_bytes() const { return offsets.size() * sizeof(int64_t) + neighbours.size() * sizeof(int); }
+};
+
+// the same graph with the neighbour lists compressed, for graphs too large to fit in memory as a CSR
+// (where the breadth first search is also limited by the memory bandwidth).
+// the neighbours of every node are sorted and stored as the gaps between consecutive neighbours,
+// each gap as a varint: 7 bits per byte, the highest bit set in every byte except the last one of the gap.
+// the first neighbour is stored as its (zigzag encoded) difference to the node itself.
+// most gaps of a sorted list are small, so most of them take a single byte instead of 4.
+struct CompressedGraph
+{
+    int N = 0;                    // number of nodes
+    std::vector<int64_t> offsets; // N + 1 positions: the encoded neighbours of node i are bytes[offsets[i]] ... bytes[offsets[i + 1] - 1]
+    std::vector<uint8_t> bytes;   // the encoded neighbours of all the nodes, node after node
+    int64_t num_neighbours = 0;   // total number of neighbours (each edge is counted in both directions)
+
+    size_t memory_bytes() const { return offsets.size() * sizeof(int64_t) + bytes.size(); }
+};
+
+// compresses a graph. The neighbours of each node end up sorted, which doesn't change any distance.
+// the CSR and the compressed graph are both in memory during the call: to build a graph that doesn't fit in memory
+// as a CSR, use compressed_graph_from_edges instead.
+CompressedGraph compress(const Graph &graph);
+
+// builds the compressed graph directly from the (src, dest) pairs, as graph_from_edges, without building the CSR:
+// the edges are read twice for each block of nodes holding ~1/8 of the neighbours (once to size the result, once to fill it),
+// so besides the edges and the result only about 1/8 of the CSR is in memory at any time.
+// The result is the same as compress(graph_from_edges(...)).
+// throws std::invalid_argument if a node is not in [0, N).
+CompressedGraph compressed_graph_from_edges(int N, const int *edges, size_t num_edges);
+
+// reads the neighbours of one node of a CompressedGraph, decoding them on the fly:
+//     NeighbourDecoder decoder(graph, node);
+//     int neighbour;
+//     while (decoder.next(neighbour)) { ... }
+class NeighbourDecoder
+{
+public:
+    NeighbourDecoder(const CompressedGraph &graph, int node)
+        : pos(graph.bytes.data() + graph.offsets[node]), end(graph.bytes.data() + graph.offsets[node + 1])
+    {
+        // the first value is the zigzag encoded difference to the node: 0, 1, 2, 3, 4, ... stand for 0, -1, 1, -2, 2, ...
+        // it is decoded here, so that next() only has to add the gaps
+        if (pos != end)
+        {
+            uint32_t zigzag = read_varint();
+            previous = node + ((zigzag & 1) ? -(int64_t)(zigzag >> 1) - 1 : (int64_t)(zigzag >> 1));
+            pending = true;
+        }
+    }
+
+    // false when there are no neighbours left
+    bool next(int &neighbour)
+    {
+        if (pending) // the first neighbour, already decoded
+        {
+            pending = false;
+        }
+        else if (pos != end)
+        {
+            previous += read_varint();
+        }
+        else
+        {
+            return false;
+        }
+        neighbour = (int)previous;
+        return true;
+    }
+
+private:
+    uint32_t read_varint()
+    {
+        uint32_t value = *pos & 0x7f;
+        int shift = 7;
+        while (*pos++ & 0x80) // the highest bit tells that the value continues in the next byte
+        {
+            value |= (uint32_t)(*pos & 0x7f) << shift;
+            shift += 7;
+        }
+        return value;
+    }
+
+    const uint8_t *pos;    // next byte to read
+    const uint8_t *end;    // end of the neighbours of the node
+    int64_t previous = 0;  // last neighbour decoded
+    bool pending = false;  // if the first neighbour was decoded but not read yet
+};
+
+// builds the graph from an array of num_edges (src, dest) pairs, flattened as in
+// {src_0, dest_0, src_1, dest_1, ...}. The neighbours keep the order in which the edges are given.
+// throws std::invalid_argument if a node is not in [0, N).
+Graph graph_from_edges(int N, const int *edges, size_t num_edges);
+
+// builds the graph from an existing CSR (offsets has N + 1 entries, neighbours has offsets[N] entries).
+// the CSR must already be symmetric: each edge must be listed in both directions.
+// throws std::invalid_argument if the offsets are not monotonic or a neighbour is not in [0, N).
+Graph graph_from_csr(int N, const int64_t *offsets, const int *neighbours);
+
+// memory reused by consecutive breadth first searches of the same thread,
+// so that nothing of size N has to be allocated (or cleared) for each source node.
+struct BfsWorkspace
+{
+    std::vector<int> dist;            // distance from the source; INT_MAX for the nodes not reached
+    std::vector<int> queue;           // nodes in the order they were reached; queue[0 .. reached - 1] are valid
+    std::vector<int64_t> level_count; // level_count[d] is the number of nodes at distance d from the source
+    int reached = 0;                  // number of nodes reached by the last search (source included)
+
+    explicit BfsWorkspace(int N);
+};
+
+// breadth first search from src: fills workspace.dist, workspace.queue and workspace.level_count.
+void breadth_first_search(const Graph &graph, int src, BfsWorkspace &workspace);
+void breadth_first_search(const CompressedGraph &graph, int src, BfsWorkspace &workspace);
+
+// efficiency of a node from the number of nodes at each distance of it:
+// sum over d >= 1 of level_count[d] / d / (N - 1)
+double efficiency_from_levels(const std::vector<int64_t> &level_count, int N);
+
+// efficiency of the node src (runs one breadth first search)
+double node_efficiency(const Graph &graph, int src, BfsWorkspace &workspace);
+
+// efficiency of the nodes first_node ... first_node + count - 1, written to eff[0 .. count - 1].
+// num_threads <= 0 uses the OpenMP default. When the library is compiled without OpenMP,
+// num_threads is ignored and the nodes are processed sequentially.
+void efficiency(const Graph &graph, int first_node, int count, int num_threads, double *eff);
+void efficiency(const CompressedGraph &graph, int first_node, int count, int num_threads, double *eff);
+
+// the same as efficiency, also giving the level_count (see BfsWorkspace) of every source in levels[i - first_node]
+void efficiency_and_levels(const Graph &graph, int first_node, int count, int num_threads, double *eff,
+                           std::vector<std::vector<int64_t>> &levels);
+void efficiency_and_levels(const CompressedGraph &graph, int first_node, int count, int num_threads, double *eff,
+                           std::vector<std::vector<int64_t>> &levels);
+
+// truncated (k-hop) efficiency of the nodes first_node ... first_node + count - 1: only the nodes up to
+// max_depth steps away are counted, so each search is limited to that neighbourhood of the source.
+// with tail_estimate, the nodes of the component farther than max_depth are counted as if they were at
+// distance max_depth + 1 (an upper bound of what they add to the efficiency).
+void truncated_efficiency(const Graph &graph, int first_node, int count, int num_threads, int max_depth, bool tail_estimate, double *eff);
+void truncated_efficiency(const CompressedGraph &graph, int first_node, int count, int num_threads, int max_depth, bool tail_estimate, double *eff);
+
+// efficiency of the nodes nodes[0 .. count - 1] (in any order, repetitions allowed), written to eff[0 .. count - 1].
+// the searches are done 64 at a time by a bit parallel breadth first search, which reads the neighbours of a node
+// once per level for all the searches that reach it at that level. The results are exactly the same as efficiency.
+// throws std::invalid_argument if a node is not in [0, N).
+void efficiency_of_nodes(const Graph &graph, const int *nodes, int count, int num_threads, double *eff);
+void efficiency_of_nodes(const CompressedGraph &graph, const int *nodes, int count, int num_threads, double *eff);
+
+// estimate of the efficiency of every node from the searches of num_samples nodes chosen at random (with the given seed).
+// the efficiency of the chosen nodes is exact; for the others, it's the mean of 1 / distance from the chosen nodes,
+// an unbiased estimate. Costs num_samples searches instead of N.
+std::vector<double> sampled_efficiency(const Graph &graph, int num_samples, uint64_t seed, int num_threads);
+std::vector<double> sampled_efficiency(const CompressedGraph &graph, int num_samples, uint64_t seed, int num_threads);
+
+// efficiency of every node of the graph
+std::vector<double> efficiency(const Graph &graph, int num_threads);
+std::vector<double> efficiency(const CompressedGraph &graph, int num_threads);
+
+// called after every batch of nodes is finished, in increasing order of first_node.
+// eff[0 .. count - 1] are the efficiencies of the nodes first_node ... first_node + count - 1,
+// and are only valid during the call. Throwing from the callback stops the computation
+// and the exception is rethrown by efficiency_batches.
+using BatchCallback = std::function<void(int first_node, int count, const double *eff)>;
+
+// efficiency of every node of the graph, streamed to callback in batches of batch_size nodes
+void efficiency_batches(const Graph &graph, int num_threads, int batch_size, const BatchCallback &callback);
+void efficiency_batches(const CompressedGraph &graph, int num_threads, int batch_size, const BatchCallback &callback);
+
+// placement of the graph in machines with several NUMA nodes (see node_eff_numa.cpp)
+enum class NumaMode
+{
+    off,        // no special placement
+    interleave, // the pages of the graph are spread over all the NUMA nodes
+    replicate   // each NUMA node gets its own copy of the graph
+};
+
+// what efficiency_numa did. The counters are the pages allocated (by every process of the machine, during the call)
+// in the NUMA node of the thread that asked for them (local) or in another node (remote); -1 if not available.
+struct NumaReport
+{
+    int nodes = 1;        // number of NUMA nodes found
+    bool applied = false; // false if the mode was off, there is a single node, no allowed CPU has a known node, or libnuma was not compiled in
+    int64_t local_allocations = -1;
+    int64_t remote_allocations = -1;
+};
+
+// efficiency of every node of the graph with the threads pinned to CPUs spread over the NUMA nodes
+// and the graph placed according to mode. Needs -DNODE_EFF_NUMA and -lnuma, otherwise it's the same as efficiency.
+std::vector<double> efficiency_numa(const Graph &graph, int num_threads, NumaMode mode, NumaReport *report = nullptr);
+
+// size of the connected component of each node
+std::vector<int> component_sizes(const Graph &graph);
+std::vector<int> component_sizes(const CompressedGraph &graph);
+
+// queries that only need the most efficient nodes (available for the CSR graph only).
+// each candidate node gets an upper bound of its efficiency from its degree and, while its breadth first search
+// goes level by level, from the levels already found. The candidates are processed from the largest bound, and the
+// search of a node is stopped as soon as its bound shows it can't be part of the answer.
+
+// a node and its exact efficiency
+struct NodeEfficiency
+{
+    int node;
+    double eff;
+};
+
+// how much work a query did: every node was either skipped without a search,
+// had its search stopped early (pruned), or had its search completed
+struct QueryStats
+{
+    int64_t skipped = 0;
+    int64_t pruned = 0;
+    int64_t completed = 0;
+};
+
+// the k nodes with the largest efficiency, from the largest to the smallest
+// (when several nodes tie with the k-th one, any of them may be returned)
+std::vector<NodeEfficiency> top_k(const Graph &graph, int k, int num_threads, QueryStats *stats = nullptr);
+
+// the nodes with efficiency >= threshold, from the largest to the smallest efficiency
+std::vector<NodeEfficiency> above_threshold(const Graph &graph, double threshold, int num_threads, QueryStats *stats = nullptr);
+
+// cache of results, so that a graph already calculated is not calculated again (see node_eff_cache.cpp).
+// the results are kept in files named by the content hash of the graph, in a directory of the user's choice.
+
+// content hash of the graph (32 hexadecimal digits). It depends only on the set of edges: not on their order,
+// their direction, repeated edges or self loops (which don't change any distance), nor on the file name.
+std::string graph_hash(const Graph &graph);
+
+// what is kept in the cache for a graph: the efficiency and the level_count of every node
+struct CachedResult
+{
+    std::vector<double> eff;
+    std::vector<std::vector<int64_t>> levels;
+};
+
+// reads the result of the graph with the given hash; false if it's not in the cache (or the file is damaged).
+// a result read is marked as recently used.
+bool cache_load(const std::string &directory, const std::string &hash, CachedResult &result);
+
+// saves the result of the graph with the given hash, then removes the least recently used results
+// until the directory holds at most max_bytes. Returns false if the result couldn't be saved.
+bool cache_store(const std::string &directory, const std::string &hash, const CachedResult &result, uint64_t max_bytes);
+
+// helpers shared by the command line programs
+
+// N is read from the .edgelist file name "???_n_'N'_k_'?_?'.edgelist"
+int node_count_from_filename(const std::string &filename);
+
+// the .edgelist file name without the ".edgelist" extension, used to name the .eff and .time files
+std::string output_prefix(const std::string &filename);
+
+// reads the (src, dest) pairs of an .edgelist file, flattened as expected by graph_from_edges
+std::vector<int> read_edgelist(std::istream &file);
+
+// writes one efficiency per line with 6 decimal places, as in the .eff files
+void write_eff(const std::string &output_file, const std::vector<double> &eff_list);
+
+// writes "node efficiency" per line, with 6 decimal places, for the answer of a query
+void write_query(const std::string &output_file, const std::vector<NodeEfficiency> &answer);
+
+// writes the elapsed time with 6 decimal places, as in the .time files
+void write_time(const std::string &output_time, double elapsed_seconds);
+
+} // namespace node_eff
+
+#endif // NODE_EFF_H
@@ -0,0 +1,294 @@
+/*
+* @author Roberto Hiroshi Matos Furuta
+* Contact: roberto.furuta@usp.br
+
+* Implementation of the libnodeeff C ABI (see node_eff_c.h).
+* No C++ exception is allowed to cross these functions: they are converted to a node_eff_status,
+* and their message is kept to be returned by node_eff_last_error().
+*/
+
+#include "node_eff_c.h"
+#include "node_eff.h"
+
+#include <new>       // for bad_alloc
+#include <stdexcept> // for invalid_argument
+#include <string>
+#include <utility>   // for move
+
+using namespace std;
+
+struct node_eff_graph
+{
+    node_eff::Graph graph;                // empty after node_eff_graph_compress
+    node_eff::CompressedGraph compressed; // only used after node_eff_graph_compress
+    bool is_compressed = false;
+};
+
+namespace
+{
+
+thread_local string last_error; // message of the last error of each thread
+
+// thrown from the batch callback wrapper when the C callback asks to stop
+struct Aborted
+{
+};
+
+// runs body, converting any exception to a node_eff_status
+template <typename Body>
+node_eff_status guarded(Body body)
+{
+    try
+    {
+        body();
+        last_error.clear();
+        return NODE_EFF_OK;
+    }
+    catch (const Aborted &)
+    {
+        last_error = "stopped by the batch callback";
+        return NODE_EFF_ABORTED;
+    }
+    catch (const invalid_argument &e)
+    {
+        last_error = e.what();
+        return NODE_EFF_INVALID_ARGUMENT;
+    }
+    catch (const bad_alloc &)
+    {
+        last_error = "out of memory";
+        return NODE_EFF_OUT_OF_MEMORY;
+    }
+    catch (const exception &e)
+    {
+        last_error = e.what();
+        return NODE_EFF_INTERNAL_ERROR;
+    }
+    catch (...)
+    {
+        last_error = "unknown error";
+        return NODE_EFF_INTERNAL_ERROR;
+    }
+}
+
+// the queries are only available for the CSR graph
+void check_not_compressed(const node_eff_graph *graph)
+{
+    if (graph->is_compressed)
+    {
+        throw invalid_argument("the queries are not available for a compressed graph");
+    }
+}
+
+void check_not_null(const void *pointer, const char *name)
+{
+    if (pointer == nullptr)
+    {
+        throw invalid_argument(string(name) + " is null");
+    }
+}
+
+// copies the answer of a query to the arrays of the caller
+void copy_answer(const vector<node_eff::NodeEfficiency> &answer, int *nodes, double *eff, int *found)
+{
+    for (size_t i = 0; i < answer.size(); i++)
+    {
+        nodes[i] = answer[i].node;
+        eff[i] = answer[i].eff;
+    }
+    *found = answer.size();
+}
+
+} // namespace
+
+extern "C"
+{
+
+int node_eff_api_version(void)
+{
+    return NODE_EFF_API_VERSION;
+}
+
+const char *node_eff_last_error(void)
+{
+    return last_error.c_str();
+}
+
+node_eff_status node_eff_graph_from_edges(int n, const int *edges, size_t num_edges, node_eff_graph **graph)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        if (num_edges > 0)
+        {
+            check_not_null(edges, "edges");
+        }
+        node_eff::Graph built = node_eff::graph_from_edges(n, edges, num_edges);
+        *graph = new node_eff_graph;
+        (*graph)->graph = move(built);
+    });
+}
+
+node_eff_status node_eff_graph_from_csr(int n, const int64_t *offsets, const int *neighbours, node_eff_graph **graph)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        check_not_null(offsets, "offsets");
+        if (n > 0 && offsets[n] > 0)
+        {
+            check_not_null(neighbours, "neighbours");
+        }
+        node_eff::Graph built = node_eff::graph_from_csr(n, offsets, neighbours);
+        *graph = new node_eff_graph;
+        (*graph)->graph = move(built);
+    });
+}
+
+node_eff_status node_eff_compressed_graph_from_edges(int n, const int *edges, size_t num_edges, node_eff_graph **graph)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        if (num_edges > 0)
+        {
+            check_not_null(edges, "edges");
+        }
+        node_eff::CompressedGraph built = node_eff::compressed_graph_from_edges(n, edges, num_edges);
+        *graph = new node_eff_graph;
+        (*graph)->compressed = move(built);
+        (*graph)->is_compressed = true;
+    });
+}
+
+void node_eff_graph_free(node_eff_graph *graph)
+{
+    delete graph;
+}
+
+int node_eff_graph_node_count(const node_eff_graph *graph)
+{
+    if (graph == nullptr)
+    {
+        return 0;
+    }
+    return graph->is_compressed ? graph->compressed.N : graph->graph.N;
+}
+
+node_eff_status node_eff_graph_compress(node_eff_graph *graph)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        if (!graph->is_compressed)
+        {
+            graph->compressed = node_eff::compress(graph->graph);
+            graph->graph = node_eff::Graph();
+            graph->is_compressed = true;
+        }
+    });
+}
+
+size_t node_eff_graph_memory_bytes(const node_eff_graph *graph)
+{
+    if (graph == nullptr)
+    {
+        return 0;
+    }
+    return graph->is_compressed ? graph->compressed.memory_bytes() : graph->graph.memory_bytes();
+}
+
+node_eff_status node_eff_compute(const node_eff_graph *graph, int num_threads, double *eff)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        check_not_null(eff, "eff");
+        if (graph->is_compressed)
+        {
+            node_eff::efficiency(graph->compressed, 0, graph->compressed.N, num_threads, eff);
+        }
+        else
+        {
+            node_eff::efficiency(graph->graph, 0, graph->graph.N, num_threads, eff);
+        }
+    });
+}
+
+node_eff_status node_eff_compute_range(const node_eff_graph *graph, int first_node, int count, int num_threads, double *eff)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        check_not_null(eff, "eff");
+        if (graph->is_compressed)
+        {
+            node_eff::efficiency(graph->compressed, first_node, count, num_threads, eff);
+        }
+        else
+        {
+            node_eff::efficiency(graph->graph, first_node, count, num_threads, eff);
+        }
+    });
+}
+
+node_eff_status node_eff_compute_truncated(const node_eff_graph *graph, int first_node, int count, int num_threads,
+                                           int max_depth, int tail_estimate, double *eff)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        check_not_null(eff, "eff");
+        if (graph->is_compressed)
+        {
+            node_eff::truncated_efficiency(graph->compressed, first_node, count, num_threads, max_depth, tail_estimate != 0, eff);
+        }
+        else
+        {
+            node_eff::truncated_efficiency(graph->graph, first_node, count, num_threads, max_depth, tail_estimate != 0, eff);
+        }
+    });
+}
+
+node_eff_status node_eff_compute_batches(const node_eff_graph *graph, int num_threads, int batch_size,
+                                         node_eff_batch_callback callback, void *user_data)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        check_not_null(reinterpret_cast<const void *>(callback), "callback");
+        auto forward = [&](int first_node, int count, const double *eff) {
+            if (callback(first_node, count, eff, user_data) != 0)
+            {
+                throw Aborted();
+            }
+        };
+        if (graph->is_compressed)
+        {
+            node_eff::efficiency_batches(graph->compressed, num_threads, batch_size, forward);
+        }
+        else
+        {
+            node_eff::efficiency_batches(graph->graph, num_threads, batch_size, forward);
+        }
+    });
+}
+
+node_eff_status node_eff_top_k(const node_eff_graph *graph, int k, int num_threads, int *nodes, double *eff, int *found)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        check_not_null(nodes, "nodes");
+        check_not_null(eff, "eff");
+        check_not_null(found, "found");
+        check_not_compressed(graph);
+        copy_answer(node_eff::top_k(graph->graph, k, num_threads), nodes, eff, found);
+    });
+}
+
+node_eff_status node_eff_above_threshold(const node_eff_graph *graph, double threshold, int num_threads,
+                                         int *nodes, double *eff, int *found)
+{
+    return guarded([&] {
+        check_not_null(graph, "graph");
+        check_not_null(nodes, "nodes");
+        check_not_null(eff, "eff");
+        check_not_null(found, "found");
+        check_not_compressed(graph);
+        copy_answer(node_eff::above_threshold(graph->graph, threshold, num_threads), nodes, eff, found);
+    });
+}
+
+} // extern "C"
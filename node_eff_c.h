@@ -0,0 +1,105 @@
+/*
+* @author Roberto Hiroshi Matos Furuta
+* Contact: roberto.furuta@usp.br
+
+* Stable C ABI of libnodeeff, for use from C or from other languages (e.g. Python ctypes).
+* It is a thin layer over the C++ API declared in node_eff.h.
+
+* Every function that can fail returns a node_eff_status; NODE_EFF_OK (0) means success.
+* When a call fails, node_eff_last_error() returns a message describing the error,
+* which is kept separately for every calling thread.
+*/
+
+#ifndef NODE_EFF_C_H
+#define NODE_EFF_C_H
+
+#include <stddef.h> /* for size_t */
+#include <stdint.h> /* for int64_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* incremented whenever a function is added; existing functions never change their signature */
+#define NODE_EFF_API_VERSION 5
+
+typedef enum node_eff_status
+{
+    NODE_EFF_OK = 0,
+    NODE_EFF_INVALID_ARGUMENT = 1, /* e.g. a node outside [0, n) or a null pointer */
+    NODE_EFF_OUT_OF_MEMORY = 2,
+    NODE_EFF_ABORTED = 3,          /* the batch callback returned a non zero value */
+    NODE_EFF_INTERNAL_ERROR = 4
+} node_eff_status;
+
+/* opaque handle to a graph held by the library */
+typedef struct node_eff_graph node_eff_graph;
+
+/* called after every batch of nodes is finished, in increasing order of first_node.
+ * eff[0 .. count - 1] are the efficiencies of the nodes first_node ... first_node + count - 1,
+ * and are only valid during the call. Returning a non zero value stops the computation. */
+typedef int (*node_eff_batch_callback)(int first_node, int count, const double *eff, void *user_data);
+
+/* NODE_EFF_API_VERSION of the library actually loaded */
+int node_eff_api_version(void);
+
+/* message of the last error in the calling thread ("" if there was none) */
+const char *node_eff_last_error(void);
+
+/* builds a graph with n nodes from num_edges (src, dest) pairs, flattened as {src_0, dest_0, src_1, dest_1, ...} */
+node_eff_status node_eff_graph_from_edges(int n, const int *edges, size_t num_edges, node_eff_graph **graph);
+
+/* builds a graph with n nodes from a CSR: offsets has n + 1 entries and neighbours has offsets[n] entries.
+ * every edge must be listed in both directions. */
+node_eff_status node_eff_graph_from_csr(int n, const int64_t *offsets, const int *neighbours, node_eff_graph **graph);
+
+/* releases a graph (null is allowed) */
+void node_eff_graph_free(node_eff_graph *graph);
+
+/* number of nodes of the graph */
+int node_eff_graph_node_count(const node_eff_graph *graph);
+
+/* replaces the graph by its compressed form (sorted neighbours stored as varint gaps), which uses less memory
+ * but is slower to traverse. The queries (node_eff_top_k, node_eff_above_threshold) are not available for it.
+ * Added in version 3. */
+node_eff_status node_eff_graph_compress(node_eff_graph *graph);
+
+/* builds a compressed graph (as node_eff_graph_compress) directly from num_edges (src, dest) pairs, flattened as in
+ * node_eff_graph_from_edges, without holding the uncompressed graph in memory. Added in version 5. */
+node_eff_status node_eff_compressed_graph_from_edges(int n, const int *edges, size_t num_edges, node_eff_graph **graph);
+
+/* memory used by the graph, in bytes. Added in version 3. */
+size_t node_eff_graph_memory_bytes(const node_eff_graph *graph);
+
+/* efficiency of every node, written to eff[0 .. n - 1].
+ * num_threads <= 0 uses the OpenMP default. */
+node_eff_status node_eff_compute(const node_eff_graph *graph, int num_threads, double *eff);
+
+/* efficiency of the nodes first_node ... first_node + count - 1, written to eff[0 .. count - 1] */
+node_eff_status node_eff_compute_range(const node_eff_graph *graph, int first_node, int count, int num_threads, double *eff);
+
+/* truncated (k-hop) efficiency of the nodes first_node ... first_node + count - 1, written to eff[0 .. count - 1]:
+ * only the nodes up to max_depth steps away are counted. With tail_estimate != 0, the farther nodes of the
+ * component are counted as if they were at distance max_depth + 1. Added in version 4. */
+node_eff_status node_eff_compute_truncated(const node_eff_graph *graph, int first_node, int count, int num_threads,
+                                           int max_depth, int tail_estimate, double *eff);
+
+/* efficiency of every node, streamed to callback in batches of batch_size nodes */
+node_eff_status node_eff_compute_batches(const node_eff_graph *graph, int num_threads, int batch_size,
+                                         node_eff_batch_callback callback, void *user_data);
+
+/* the k nodes with the largest efficiency, from the largest to the smallest: nodes[0 .. *found - 1] and eff[0 .. *found - 1].
+ * nodes and eff must have room for k entries. Added in version 2. */
+node_eff_status node_eff_top_k(const node_eff_graph *graph, int k, int num_threads, int *nodes, double *eff, int *found);
+
+/* the nodes with efficiency >= threshold, from the largest to the smallest efficiency: nodes[0 .. *found - 1] and
+ * eff[0 .. *found - 1]. nodes and eff must have room for n entries. Added in version 2. */
+node_eff_status node_eff_above_threshold(const node_eff_graph *graph, double threshold, int num_threads,
+                                         int *nodes, double *eff, int *found);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NODE_EFF_C_H */
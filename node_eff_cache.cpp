@@ -0,0 +1,232 @@
+/*
+* @author Roberto Hiroshi Matos Furuta
+* Contact: roberto.furuta@usp.br
+
+* Cache of results of libnodeeff (see node_eff.h).
+
+* Each graph is identified by a hash of its set of edges, so the same graph is found again even if its
+* .edgelist file has another name or lists the edges in another order. The result of each graph is kept
+* in its own binary file, "<hash>.cache", with the exact efficiencies (not rounded to 6 decimal places)
+* and the number of nodes at each distance of every node:
+*     "NODEEFF1", N, eff[0 .. N - 1], then for each node: number of levels L, level_count[0 .. L - 1]
+* (all numbers as int64_t or double). When the directory grows over its maximum size, the files
+* used the longest time ago are removed.
+*/
+
+#include "node_eff.h"
+
+#include <algorithm>  // for sort
+#include <cstring>    // for memcmp
+#include <filesystem> // for the cache directory
+#include <fstream>    // for file mannagement
+#include <iomanip>    // for the hexadecimal hash
+#include <random>     // for the name of the temporary files
+#include <sstream>    // for string stream
+#include <system_error>
+#include <utility>    // for move
+
+#include <unistd.h>   // for getpid
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace node_eff
+{
+
+namespace
+{
+
+const char magic[8] = {'N', 'O', 'D', 'E', 'E', 'F', 'F', '1'}; // first bytes of every cache file
+
+// mixes the bits of a 64 bit value (the finalizer of splitmix64)
+uint64_t mix(uint64_t value)
+{
+    value += 0x9e3779b97f4a7c15;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+    return value ^ (value >> 31);
+}
+
+template <typename T>
+void write_value(ofstream &file, T value)
+{
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool read_value(ifstream &file, T &value)
+{
+    return (bool)file.read(reinterpret_cast<char *>(&value), sizeof(value));
+}
+
+// removes the least recently used files of the cache until it holds at most max_bytes
+void evict(const fs::path &directory, uint64_t max_bytes)
+{
+    struct Entry
+    {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type used;
+    };
+    vector<Entry> entries;
+    uint64_t total = 0;
+    for (const fs::directory_entry &entry : fs::directory_iterator(directory))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".cache")
+        {
+            entries.push_back({entry.path(), (uint64_t)entry.file_size(), entry.last_write_time()});
+            total += entries.back().size;
+        }
+    }
+    sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    for (const Entry &entry : entries)
+    {
+        if (total <= max_bytes)
+        {
+            break;
+        }
+        error_code error;
+        if (fs::remove(entry.path, error))
+        {
+            total -= entry.size;
+        }
+    }
+}
+
+// reads a cache file; false if it doesn't exist or is damaged
+bool load(const fs::path &path, CachedResult &result)
+{
+    ifstream file(path, ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    char header[sizeof(magic)];
+    int64_t N;
+    if (!file.read(header, sizeof(header)) || memcmp(header, magic, sizeof(magic)) != 0 || !read_value(file, N) || N < 0)
+    {
+        return false;
+    }
+    CachedResult loaded;
+    loaded.eff.resize(N);
+    if (!file.read(reinterpret_cast<char *>(loaded.eff.data()), N * sizeof(double)))
+    {
+        return false;
+    }
+    loaded.levels.resize(N);
+    for (vector<int64_t> &level_count : loaded.levels)
+    {
+        int64_t num_levels;
+        if (!read_value(file, num_levels) || num_levels < 0 || num_levels > N)
+        {
+            return false;
+        }
+        level_count.resize(num_levels);
+        if (!file.read(reinterpret_cast<char *>(level_count.data()), num_levels * sizeof(int64_t)))
+        {
+            return false;
+        }
+    }
+    result = move(loaded);
+
+    error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error); // marked as recently used
+    return true;
+}
+
+} // namespace
+
+string graph_hash(const Graph &graph)
+{
+    // two independent 64 bit hashes of the sequence: N, then for each node
+    // the number of its distinct neighbours (self loops excluded) and these neighbours sorted
+    uint64_t first = mix(graph.N), second = mix(~(uint64_t)graph.N);
+    auto add = [&](uint64_t value) {
+        first = mix(first ^ value);
+        second = mix(second + value * 0xff51afd7ed558ccd);
+    };
+
+    vector<int> sorted; // the neighbours of one node, sorted
+    for (int i = 0; i < graph.N; i++)
+    {
+        sorted.assign(graph.neighbours.begin() + graph.offsets[i], graph.neighbours.begin() + graph.offsets[i + 1]);
+        sort(sorted.begin(), sorted.end());
+        sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+        sorted.erase(remove(sorted.begin(), sorted.end(), i), sorted.end());
+
+        add(sorted.size());
+        for (int neighbour : sorted)
+        {
+            add(neighbour);
+        }
+    }
+
+    stringstream hash;
+    hash << hex << setfill('0') << setw(16) << first << setw(16) << second;
+    return hash.str();
+}
+
+bool cache_load(const string &directory, const string &hash, CachedResult &result)
+{
+    try
+    {
+        return load(fs::path(directory) / (hash + ".cache"), result);
+    }
+    catch (const exception &) // e.g. a damaged file asking for too much memory
+    {
+        return false;
+    }
+}
+
+bool cache_store(const string &directory, const string &hash, const CachedResult &result, uint64_t max_bytes)
+{
+    error_code error;
+    fs::create_directories(directory, error);
+    fs::path path = fs::path(directory) / (hash + ".cache");
+    // each writer has its own temporary file (runs of the same graph at the same time would otherwise write
+    // to the same one, and rename it while another is still filling it)
+    stringstream unique;
+    unique << hex << getpid() << "." << random_device()();
+    fs::path temporary = fs::path(directory) / (hash + "." + unique.str() + ".tmp");
+    {
+        // written to a temporary file and then renamed, so a run that stops in the middle
+        // (or another run reading the cache) never sees an incomplete file
+        ofstream file(temporary, ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write(magic, sizeof(magic));
+        write_value<int64_t>(file, result.eff.size());
+        file.write(reinterpret_cast<const char *>(result.eff.data()), result.eff.size() * sizeof(double));
+        for (const vector<int64_t> &level_count : result.levels)
+        {
+            write_value<int64_t>(file, level_count.size());
+            file.write(reinterpret_cast<const char *>(level_count.data()), level_count.size() * sizeof(int64_t));
+        }
+        if (!file)
+        {
+            fs::remove(temporary, error);
+            return false;
+        }
+    }
+    fs::rename(temporary, path, error);
+    if (error)
+    {
+        fs::remove(temporary, error);
+        return false;
+    }
+
+    try
+    {
+        evict(directory, max_bytes);
+    }
+    catch (const fs::filesystem_error &)
+    {
+        // the result is saved; the cache is just left larger than asked
+    }
+    return fs::exists(path, error);
+}
+
+} // namespace node_eff
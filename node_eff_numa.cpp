@@ -0,0 +1,241 @@
+/*
+* @author Roberto Hiroshi Matos Furuta
+* Contact: roberto.furuta@usp.br
+
+* NUMA aware version of the efficiency loop (see node_eff::efficiency_numa in node_eff.h).
+
+* In a machine with several NUMA nodes (e.g. two sockets), every page of memory belongs to one of them,
+* and a thread reads the memory of its own node faster than the memory of the others.
+* Linux places a page in the node of the thread that writes it first ("first touch"), so a graph
+* built by the main thread ends up entirely in its node. Here the threads are pinned to CPUs spread
+* over the nodes, and the graph is either:
+* - interleaved: its pages are moved to be spread over all the nodes, or
+* - replicated: each node gets its own copy, written by a thread running on it, and every thread reads the copy of its node.
+* The workspace of each thread is allocated after the thread is pinned, so it's local as well.
+
+* It needs libnuma: compile with -DNODE_EFF_NUMA and link with -lnuma. Without it, or in a machine with
+* a single NUMA node, efficiency_numa does the same as efficiency.
+*/
+
+#include "node_eff.h"
+
+#include <algorithm> // for max
+#include <fstream>   // for reading the numastat files
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef NODE_EFF_NUMA
+#include <numa.h>
+#include <numaif.h> // for mbind
+#include <sched.h>  // for sched_setaffinity
+#include <unistd.h> // for sysconf
+#endif
+
+using namespace std;
+
+namespace node_eff
+{
+
+namespace
+{
+
+// sums the local_node and other_node counters of every NUMA node: the pages allocated by the processes
+// running in a node from its own memory, or from the memory of another node.
+// returns false if the counters are not available (e.g. not Linux).
+bool read_numastat(int64_t &local, int64_t &remote)
+{
+    local = 0;
+    remote = 0;
+    bool found = false;
+    for (int node = 0; node < 1024; node++)
+    {
+        ifstream file("/sys/devices/system/node/node" + to_string(node) + "/numastat");
+        if (!file.is_open())
+        {
+            continue; // the node numbers may have gaps
+        }
+        string name;
+        int64_t value;
+        while (file >> name >> value)
+        {
+            if (name == "local_node")
+            {
+                local += value;
+            }
+            else if (name == "other_node")
+            {
+                remote += value;
+            }
+        }
+        found = true;
+    }
+    return found;
+}
+
+#ifdef NODE_EFF_NUMA
+
+// the CPUs this process may run on, alternating between the NUMA nodes
+// (first CPU of node 0, first CPU of node 1, ..., second CPU of node 0, ...),
+// so that any number of threads is spread evenly over the nodes. Empty if no CPU has a known node.
+vector<int> spread_cpus()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    vector<vector<int>> cpus_of_node(numa_max_node() + 1);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        int node = numa_node_of_cpu(cpu);
+        if (CPU_ISSET(cpu, &allowed) && node >= 0)
+        {
+            cpus_of_node[node].push_back(cpu);
+        }
+    }
+
+    size_t rounds = 0; // the allowed CPUs of unknown node (numa_node_of_cpu < 0) are left out
+    for (const vector<int> &node_cpus : cpus_of_node)
+    {
+        rounds = max(rounds, node_cpus.size());
+    }
+    vector<int> cpus;
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (const vector<int> &node_cpus : cpus_of_node)
+        {
+            if (round < node_cpus.size())
+            {
+                cpus.push_back(node_cpus[round]);
+            }
+        }
+    }
+    return cpus;
+}
+
+// pins the calling thread to one CPU
+void pin_to_cpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+// moves the pages of a vector so they are spread over all the NUMA nodes.
+// only the pages entirely inside the vector are moved, so nothing else is affected.
+template <typename T>
+void interleave(const vector<T> &data)
+{
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t begin = ((uintptr_t)data.data() + page - 1) / page * page;
+    uintptr_t end = ((uintptr_t)(data.data() + data.size())) / page * page;
+    if (begin < end)
+    {
+        mbind((void *)begin, end - begin, MPOL_INTERLEAVE, numa_all_nodes_ptr->maskp, numa_all_nodes_ptr->size + 1, MPOL_MF_MOVE);
+    }
+}
+
+#endif
+
+} // namespace
+
+vector<double> efficiency_numa(const Graph &graph, int num_threads, NumaMode mode, NumaReport *report)
+{
+    NumaReport result;
+    int64_t local_before, remote_before;
+    bool counters = read_numastat(local_before, remote_before);
+
+#ifdef NODE_EFF_NUMA
+    result.nodes = numa_available() < 0 ? 1 : numa_num_configured_nodes();
+#endif
+
+    vector<double> eff_list; // stores the efficiency of each node
+    if (mode == NumaMode::off || result.nodes <= 1)
+    {
+        eff_list = efficiency(graph, num_threads); // nothing to place in a single node
+    }
+#ifdef NODE_EFF_NUMA
+    else if (spread_cpus().empty())
+    {
+        eff_list = efficiency(graph, num_threads); // no CPU of a known node to pin the threads to
+    }
+    else
+    {
+        result.applied = true;
+#ifdef _OPENMP
+        if (num_threads <= 0)
+        {
+            num_threads = omp_get_max_threads();
+        }
+#endif
+        vector<int> cpus = spread_cpus();
+        cpu_set_t original;
+        sched_getaffinity(0, sizeof(original), &original);
+
+        vector<Graph> replicas; // replicas[node] is the copy of the graph in the memory of that node
+        if (mode == NumaMode::replicate)
+        {
+            replicas.resize(numa_max_node() + 1);
+            for (int node = 0; node <= numa_max_node(); node++)
+            {
+                if (numa_bitmask_isbitset(numa_all_nodes_ptr, node))
+                {
+                    // the copy is written while running on the node, so its pages are placed there
+                    numa_run_on_node(node);
+                    numa_set_preferred(node);
+                    replicas[node] = graph;
+                }
+            }
+            numa_set_localalloc();
+            sched_setaffinity(0, sizeof(original), &original);
+        }
+        else
+        {
+            interleave(graph.offsets);
+            interleave(graph.neighbours);
+        }
+
+        eff_list.assign(graph.N, 0);
+#pragma omp parallel default(none) shared(graph, mode, cpus, replicas, eff_list) num_threads(num_threads)
+        {
+#ifdef _OPENMP
+            int thread = omp_get_thread_num();
+#else
+            int thread = 0;
+#endif
+            int cpu = cpus[thread % cpus.size()];
+            cpu_set_t thread_original; // the OpenMP threads are reused by later parallel regions, so each one is unpinned at the end
+            sched_getaffinity(0, sizeof(thread_original), &thread_original);
+            pin_to_cpu(cpu);
+            int node = numa_node_of_cpu(cpu);
+            // the nodes without memory for this process (numactl -m, memoryless nodes) have no replica
+            bool has_replica = mode == NumaMode::replicate && node >= 0 && node < (int)replicas.size() && replicas[node].N == graph.N;
+            const Graph &local_graph = has_replica ? replicas[node] : graph;
+
+            BfsWorkspace workspace(graph.N); // allocated after pinning, so it's in the memory of the node
+#pragma omp for
+            for (int i = 0; i < graph.N; i++) // for every node:
+            {
+                eff_list[i] = node_efficiency(local_graph, i, workspace);
+            }
+            sched_setaffinity(0, sizeof(thread_original), &thread_original);
+        }
+    }
+#endif
+
+    int64_t local_after, remote_after;
+    if (counters && read_numastat(local_after, remote_after))
+    {
+        result.local_allocations = local_after - local_before;
+        result.remote_allocations = remote_after - remote_before;
+    }
+    if (report != nullptr)
+    {
+        *report = result;
+    }
+    return eff_list;
+}
+
+} // namespace node_eff
@@ -17,75 +17,78 @@
 * adjacency list to store the graph data.
 
 * The program is implemented using MPI for parallel processing.
+
+* The calculation itself is done by libnodeeff (node_eff.h), this program only reads the .edgelist file,
+* distributes the nodes between the processes and writes the .eff file.
 */
 
-#include <climits> //to use INT_MAX
 #include <vector>
 #include <string>
-#include <sstream>  // for string stream
 #include <iostream> // for data mannagement
 #include <fstream>  // for file mannagement
-#include <iomanip>  // for setting the precision
 #include <chrono>   // for monitoring the elapsed time
 #include <mpi.h>    // for using mpi
 #include <numeric>  // to be able to create "counts" and "displs"
+#include <algorithm> // for fill and fill_n
+#include <stdexcept> // for exception
+#include "node_eff.h"
 
 using namespace std;
 
-// adj_list is used as a constant reference to avoid copying
-
-// this function is implemented equally to the sequential program
-void breadth_first_search(const vector<vector<int>> &adj_list, int src, int N, vector<int> &dist)
+int main(int argc, char *argv[])
 {
-    vector<int> queue(N); // vector of sequence of nodes to evaluate
-    //before, the queue as implemented using a list object, which was easier,
-    //but after changing to an implementation with vector, the code got approx. 2 times faster.
-    int pos = 0;        // the position in queue of the next node to evaluate
-    int next_empty = 1; // the position in the queue to which a new node will be added
+    MPI_Init(&argc, &argv); // begin MPI code segment
 
-    vector<bool> visited(N, false); // each position represents each node, it stores if the node was visited at least once
+    int N_proc, rank; //number of processes and rank of each process (+ communicator)
 
-    // updating the first node: src
-    visited[src] = true;
-    dist[src] = 0;
-    queue[0] = src;
+    MPI_Comm_size(MPI_COMM_WORLD, &N_proc);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    while (pos < next_empty) // while there are nodes in the queue which were not evaluated yet
-    {
-        int node = queue[pos]; // the first node is chosen
-        pos += 1;              // and it is removed from the queue
+    // reads the program name and the .edgelist file name from the terminal,
+    // optionally followed by "--max-depth K" for the truncated efficiency, counting only the nodes up to K steps away,
+    // and "--tail-estimate" to count the farther nodes of the component as if at K + 1 steps
 
-        for (unsigned int i = 0; i < adj_list[node].size(); i++) // for each index of neighbour
-        // here we have spacial locality by accessing the adj_list[node] entries, allocated sequentially
+    bool truncated = false; // --max-depth was given
+    int max_depth = 0;
+    bool tail_estimate = false;
+    bool valid_arguments = argc >= 2;
+    for (int a = 2; a < argc && valid_arguments; a++)
+    {
+        string option = argv[a];
+        if (option == "--max-depth" && a + 1 < argc)
         {
-            if (visited[adj_list[node][i]] == false) // if it's not been visited:
+            truncated = true;
+            size_t end = 0;
+            string value = argv[++a];
+            try
+            {
+                max_depth = stoi(value, &end);
+            }
+            catch (const exception &) // not a number, rejected below as K < 1
             {
-                visited[adj_list[node][i]] = true;        // update to visited
-                dist[adj_list[node][i]] = dist[node] + 1; // +1 step distance to the neighbour adj_list[node][i]
-                queue[next_empty] = (adj_list[node][i]);  // add to the queue
-                next_empty += 1;                          // update the next empty position
             }
+            max_depth = end == value.size() ? max_depth : 0;
+        }
+        else if (option == "--tail-estimate")
+        {
+            tail_estimate = true;
+        }
+        else
+        {
+            valid_arguments = false;
         }
     }
-}
-
-int main(int argc, char *argv[])
-{
-    MPI_Init(&argc, &argv); // begin MPI code segment
-
-    int N_proc, rank; //number of processes and rank of each process (+ communicator)
-
-    MPI_Comm_size(MPI_COMM_WORLD, &N_proc);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-
-    // reads the program name and the .edgelist file name from the terminal
+    if ((truncated || tail_estimate) && max_depth < 1)
+    {
+        valid_arguments = false;
+    }
 
-    // checks if the number of arguments doesn't mach the expected amount
-    if (argc != 2)
+    // checks if the arguments don't mach the expected ones
+    if (!valid_arguments)
     {
         if (rank == 0)
         {
-            cerr << "Give in the command line the .edgelist file name and the number of threads.\n";
+            cerr << "Give in the command line the .edgelist file name, optionally followed by --max-depth K [--tail-estimate].\n";
         }
         MPI_Finalize(); // finalizes all processes
         return 1;
@@ -105,51 +108,33 @@ int main(int argc, char *argv[])
 
     // if there is no error so far
     // the number of nodes read.
-    int N; // N is read from the .edgelist file name "???_n_'N'_k_'?_?'.edgelist"
-    vector<string> split_file_name;
-    stringstream s_stream(argv[1]); // string stream object
-    while (s_stream.good())
-    {
-        string substr;
-        getline(s_stream, substr, '_'); // splits the filename at "_"
-        split_file_name.push_back(substr);
-    }
-
-    N = stoi(split_file_name[2]); // the N is the [2]th element
+    int N = node_eff::node_count_from_filename(argv[1]); // N is read from the .edgelist file name "???_n_'N'_k_'?_?'.edgelist"
 
     string output_file; // file in which the efficiency list will be saved
     string output_time; // file in which the spent time will be saved
     if (rank == 0)
     {
         // creating the .eff filename to use later
-        output_file = argv[1];
-        size_t pos = output_file.find(".edgelist");
-        output_file = output_file.substr(0, pos);
-        output_time = output_file;
+        // (the truncated efficiency is saved to "???_depth_'K'.eff", to not be mistaken for the complete one)
+        output_file = node_eff::output_prefix(argv[1]);
+        if (truncated)
+        {
+            output_file += "_depth_" + to_string(max_depth);
+        }
+        // (and the time to "???_depth_'K'_mpi_.time", to not replace the time of the complete one)
+        output_time = output_file + "_mpi_.time";
         output_file += ".eff";
-        output_time += "_mpi_.time";
     }
 
-    // the adjacency list (vector of vector of int) will be created
+    // the graph (CSR adjacency) will be created
     // from the edge list.
     // the edge list is flattened to facilitate the broadcasting
     // doing it in one message, minimizing communication time
-    vector<vector<int>> adj_list(N);
     vector<int> flat_edgelist;
 
-    // reading the edge list from file:
-    string line;
-    int src, dest;
-
     if (rank == 0) // rank 0 (root) reads the edge list from file
     {
-        while (getline(file, line)) // for each line in the edgelist file,
-        {
-            istringstream ss(line);
-            ss >> src >> dest; // the src (source) and dest (destination) node pair (edge) is read
-            flat_edgelist.push_back(src);
-            flat_edgelist.push_back(dest);
-        };
+        flat_edgelist = node_eff::read_edgelist(file);
     }
 
     // the size of the flat_edgelist is identified and broadcasted from root (rank 0) to all
@@ -159,18 +144,10 @@ int main(int argc, char *argv[])
 
     // the content of the flat_edgelist is broadcasted from root to all
     flat_edgelist.resize(flat_edgelist_size);
-    MPI_Bcast(&flat_edgelist[0], flat_edgelist.size(), MPI_INT, 0, MPI_COMM_WORLD);
-
-    //this flat edgelist is converted to an adjacency list, in every process
-    for (int i = 0; i < flat_edgelist.size() / 2; i++) // for every edge:
-    {
-        src = flat_edgelist[2 * i];
-        dest = flat_edgelist[2 * i + 1];
-        adj_list[src].push_back(dest); // append the neighbour to the list of adjacent nodes
-        adj_list[dest].push_back(src); // append the neighbour to the list of adjacent nodes
-    }
+    MPI_Bcast(flat_edgelist.data(), flat_edgelist.size(), MPI_INT, 0, MPI_COMM_WORLD);
 
-    vector<double> partial_eff_list; // stores the efficiency of each node
+    //this flat edgelist is converted to a graph, in every process
+    node_eff::Graph graph = node_eff::graph_from_edges(N, flat_edgelist.data(), flat_edgelist.size() / 2);
 
     // Distribution of elements per process.
     // Each process will be responsable for calculating the efficiency of
@@ -199,27 +176,21 @@ int main(int argc, char *argv[])
         start = chrono::system_clock::now();
     }
 
-    for (int i = displs[rank]; i < displs[rank] + counts[rank]; i++) // for every node:
+    // every process calculates the efficiency of its own nodes, using a single thread
+    vector<double> partial_eff_list(counts[rank]); // stores the efficiency of each node of this process
+    if (truncated)
     {
-        vector<int> dist_from_src(N, INT_MAX);               // stores the distances from src to node = index
-        breadth_first_search(adj_list, i, N, dist_from_src); // gets the distance from node i to all the nodes
-        double eff(0);                                       // stores de efficiency of the node i
-
-        for (int j = 0; j < N; j++) // for each neighbour:
-        // here we have spacial locality between the distances allocated in the dist_from_src vector
-        {
-            if (i != j && dist_from_src[j] != INT_MAX)  // if it's not the source node itself, neither isolated:
-            {                                           // here we have temporal locality of accessing eff_list[i] several times.
-                eff += 1. / dist_from_src[j] / (N - 1); // increment the efficiency
-            }
-        }
-        partial_eff_list.push_back(eff); // the value of eff is transferred to the global eff_list vector
+        node_eff::truncated_efficiency(graph, displs[rank], counts[rank], 1, max_depth, tail_estimate, partial_eff_list.data());
+    }
+    else
+    {
+        node_eff::efficiency(graph, displs[rank], counts[rank], 1, partial_eff_list.data());
     }
 
     // Gathering
     vector<double> global_eff_list(N); // stores the efficiency of all nodes
-    MPI_Gatherv(&partial_eff_list[0], counts[rank], MPI_DOUBLE,
-                &global_eff_list[0], &counts[0], &displs[0], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(partial_eff_list.data(), counts[rank], MPI_DOUBLE,
+                global_eff_list.data(), counts.data(), displs.data(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
 
     // Outputting
     if (rank == 0)
@@ -230,26 +201,10 @@ int main(int argc, char *argv[])
         cout << elapsed_seconds.count() << endl;
 
         // saving time into file
-        ofstream timefile(output_time);
-        timefile << setprecision(6) << fixed; // set 6 decimal places
-        if (timefile.is_open())
-        {
-            timefile << elapsed_seconds.count() << endl;
-        }
-        timefile.close();
+        node_eff::write_time(output_time, elapsed_seconds.count());
 
         // after the eff_list is completely filled, it's content is written to the output_file
-        ofstream myfile(output_file);
-        for (int i = 0; i < N; i++)
-        {
-            myfile << setprecision(6) << fixed; // set 6 decimal places
-
-            if (myfile.is_open())
-            {
-                myfile << global_eff_list[i] << endl;
-            }
-        }
-        myfile.close();
+        node_eff::write_eff(output_file, global_eff_list);
     }
     MPI_Finalize();
     return 0;
@@ -15,60 +15,133 @@
 * To execute the BFS, it is more convenient and efficient to have the list of adjacent nodes for every node (instead of
 * having to loop over the sparse adjacency matrix or the badly structured edge list), therefore we use the
 * adjacency list to store the graph data.
+
+* The calculation itself is done by libnodeeff (node_eff.h), this program only reads the .edgelist file
+* and writes the .eff file.
 */
 
-#include <climits> //to use INT_MAX
-#include <vector>
-#include <string>
-#include <sstream>  // for string stream
 #include <iostream> // for data mannagement
 #include <fstream>  // for file mannagement
-#include <iomanip>  // for setting the precision
 #include <chrono>   // for monitoring the elapsed time
+#include <utility>  // for move
+#include <climits>  // for INT_MAX
+#include <cmath>    // for floor and isnan
+#include <limits>   // for quiet_NaN
+#include "node_eff.h"
 
 using namespace std;
 
-// adj_list is used as a constant reference to avoid copying
-void breadth_first_search(const vector<vector<int>> &adj_list, int src, int N, vector<int> &dist)
+int main(int argc, char *argv[])
 {
-    vector<int> queue(N); // vector of sequence of nodes to evaluate
-    //before, the queue as implemented using a list object, which was easier,
-    //but after changing to an implementation with vector, the code got approx. 2 times faster.
-    int pos = 0;        // the position in queue of the next node to evaluate
-    int next_empty = 1; // the position in the queue to which a new node will be added
-
-    vector<bool> visited(N, false); // each position represents each node, it stores if the node was visited at least once
-
-    // updating the first node: src
-    visited[src] = true;
-    dist[src] = 0;
-    queue[0] = src;
-
-    while (pos < next_empty) // while there are nodes in the queue which were not evaluated yet
+    // Reads the program name, the .edgelist file name from the terminal and the number of threads to be used,
+    // optionally followed by:
+    // a query: "--top-k K" (the K most efficient nodes) or "--threshold T" (the nodes with efficiency >= T)
+    // "--compressed": the graph is kept with its neighbour lists compressed (see node_eff::CompressedGraph)
+    // "--numa interleave" or "--numa replicate": placement of the graph in machines with several NUMA nodes (see node_eff_numa.cpp)
+    // "--max-depth K": truncated efficiency, counting only the nodes up to K steps away,
+    // and "--tail-estimate": with the farther nodes of the component counted as if at K + 1 steps
+    // "--cache DIR": the results are kept in the directory DIR, and a graph already calculated is read from there
+    // (see node_eff_cache.cpp), and "--cache-size MB": the maximum size of the directory, 1024 MB by default
+    if (argc < 3)
     {
-        int node = queue[pos]; // the first node is chosen
-        pos += 1;              // and it is removed from the queue
+        cerr
+            << "Give in the command line the .edgelist file name and the number of threads,\n"
+            << "optionally followed by --top-k K or --threshold T, --compressed, --numa interleave|replicate\n"
+            << "--max-depth K [--tail-estimate] and --cache DIR [--cache-size MB].\n";
+        return 1;
+    }
 
-        for (unsigned int i = 0; i < adj_list[node].size(); i++) // for each index of neighbour
-        // here we have spacial locality by accessing the adj_list[node] entries, allocated sequencially
+    string query; // "" for the efficiency of every node
+    double query_value = 0;
+    bool compressed = false;
+    node_eff::NumaMode numa_mode = node_eff::NumaMode::off;
+    bool truncated = false; // --max-depth was given
+    int max_depth = 0;
+    bool tail_estimate = false;
+    string cache_directory; // "" without cache
+    double cache_size = 1024; // in MB
+    // the value of an option, or NaN if it's not a number (e.g. "--top-k abc")
+    auto number = [](const string &text) {
+        size_t end = 0;
+        double value = numeric_limits<double>::quiet_NaN();
+        try
+        {
+            value = stod(text, &end);
+        }
+        catch (const exception &) // invalid_argument or out_of_range
+        {
+        }
+        return end == text.size() ? value : numeric_limits<double>::quiet_NaN();
+    };
+    bool valid_values = true;
+    for (int a = 3; a < argc; a++)
+    {
+        string option = argv[a];
+        if ((option == "--top-k" || option == "--threshold") && a + 1 < argc && query.empty())
+        {
+            query = option;
+            query_value = number(argv[++a]);
+            // --top-k needs a whole K in [0, 2^31), --threshold any number
+            valid_values = valid_values && (option == "--threshold" ? !std::isnan(query_value)
+                                                                    : query_value >= 0 && query_value <= INT_MAX && query_value == floor(query_value));
+        }
+        else if (option == "--compressed")
+        {
+            compressed = true;
+        }
+        else if (option == "--numa" && a + 1 < argc && (string(argv[a + 1]) == "interleave" || string(argv[a + 1]) == "replicate"))
+        {
+            numa_mode = string(argv[++a]) == "interleave" ? node_eff::NumaMode::interleave : node_eff::NumaMode::replicate;
+        }
+        else if (option == "--max-depth" && a + 1 < argc)
+        {
+            truncated = true;
+            double value = number(argv[++a]);
+            max_depth = value >= 1 && value <= INT_MAX && value == floor(value) ? (int)value : 0; // 0 is rejected below
+        }
+        else if (option == "--tail-estimate")
+        {
+            tail_estimate = true;
+        }
+        else if (option == "--cache" && a + 1 < argc)
+        {
+            cache_directory = argv[++a];
+        }
+        else if (option == "--cache-size" && a + 1 < argc)
+        {
+            cache_size = number(argv[++a]);
+            valid_values = valid_values && cache_size >= 0;
+        }
+        else
         {
-            if (visited[adj_list[node][i]] == false) // if it's not been visited:
-            {
-                visited[adj_list[node][i]] = true;        // update to visited
-                dist[adj_list[node][i]] = dist[node] + 1; // +1 step distance to the neighbour adj_list[node][i]
-                queue[next_empty] = (adj_list[node][i]);  // add to the queue
-                next_empty += 1;                          // update the next empty position
-            }
+            cerr << "Unknown option " << option << ", use --top-k K or --threshold T, --compressed, --numa interleave|replicate,"
+                 << " --max-depth K [--tail-estimate] and --cache DIR [--cache-size MB].\n";
+            return 1;
         }
     }
-}
-
-int main(int argc, char *argv[])
-{
-    if (argc != 3) // Reads the program name, the .edgelist file name from the terminal and the number of threads to be used
+    if (!valid_values)
     {
-        cerr
-            << "Give in the command line the .edgelist file name and the number of threads.\n";
+        cerr << "--top-k needs a whole K >= 0, --threshold a number T and --cache-size a number of MB >= 0.\n";
+        return 1;
+    }
+    if (compressed && !query.empty())
+    {
+        cerr << "The queries are not available for the compressed graph.\n";
+        return 1;
+    }
+    if (numa_mode != node_eff::NumaMode::off && (compressed || !query.empty()))
+    {
+        cerr << "--numa is only available for the efficiency of every node of the uncompressed graph.\n";
+        return 1;
+    }
+    if ((truncated || tail_estimate) && (max_depth < 1 || !query.empty() || numa_mode != node_eff::NumaMode::off))
+    {
+        cerr << "--max-depth needs K >= 1, --tail-estimate needs --max-depth, and they can't be combined with the queries or --numa.\n";
+        return 1;
+    }
+    if (!cache_directory.empty() && (!query.empty() || truncated || numa_mode != node_eff::NumaMode::off))
+    {
+        cerr << "--cache is only available for the efficiency of every node, without --numa.\n";
         return 1;
     }
 
@@ -79,103 +152,182 @@ int main(int argc, char *argv[])
         return 2;
     }
 
-    unsigned int num_threads = std::stoi(argv[2]); // the number of threads is read from argv
+    int num_threads = std::stoi(argv[2]); // the number of threads is read from argv
 
     // if there is no error,
     // the number of nodes read.
-    int N; // N is read from the .edgelist file name "???_n_'N'_k_'?_?'.edgelist"
-    vector<string> split_file_name;
-    stringstream s_stream(argv[1]); // string stream object
-    while (s_stream.good())
+    int N = node_eff::node_count_from_filename(argv[1]); // N is read from the .edgelist file name "???_n_'N'_k_'?_?'.edgelist"
+
+    // creating the .eff filename to use later
+    // (the queries only output some of the nodes, so they are saved to a .query file instead,
+    // and the truncated efficiency is saved to "???_depth_'K'.eff", to not be mistaken for the complete one)
+    string output_file = node_eff::output_prefix(argv[1]);
+    if (truncated)
     {
-        string substr;
-        getline(s_stream, substr, '_'); // splits the filename at "_"
-        split_file_name.push_back(substr);
+        output_file += "_depth_" + to_string(max_depth);
     }
+    // the time is saved to "???_omp_.time" only for the complete efficiency calculated as the other programs do,
+    // and to "???_query_omp_.time", "???_depth_'K'_compressed_omp_.time", ... otherwise, so it's not mistaken for it
+    string output_time = output_file + (query.empty() ? "" : "_query") + (compressed ? "_compressed" : "")
+                         + (numa_mode == node_eff::NumaMode::off ? "" : "_numa") + "_omp_.time";
+    output_file += query.empty() ? ".eff" : ".query";
 
-    N = stoi(split_file_name[2]); // the N is the [2]th element
+    // the graph (CSR adjacency) is created from the edge list.
+    // with --compressed (and without cache, which needs the CSR for the hash), the compressed graph is built
+    // directly from the edge list instead, so the CSR is never in memory.
+    vector<int> flat_edgelist = node_eff::read_edgelist(file);
+    node_eff::Graph graph;
+    node_eff::CompressedGraph compressed_graph;
+    if (compressed && cache_directory.empty())
+    {
+        compressed_graph = node_eff::compressed_graph_from_edges(N, flat_edgelist.data(), flat_edgelist.size() / 2);
+    }
+    else
+    {
+        graph = node_eff::graph_from_edges(N, flat_edgelist.data(), flat_edgelist.size() / 2);
+    }
+    flat_edgelist = vector<int>();
 
-    // creating the .eff filename to use later
-    string output_file;
-    string output_time;
-
-    output_file = argv[1];
-    size_t pos = output_file.find(".edgelist");
-    output_file = output_file.substr(0, pos);
-    output_time = output_file;
-    output_file += ".eff";
-    output_time += "_omp_.time";
-
-    // the adjacency list (vector of vector of int) will be created
-    vector<vector<int>> adj_list(N);
-
-    string line;
-    while (getline(file, line)) // for each line in the edgelist file,
-    {
-        int src, dest;
-        istringstream ss(line);
-        ss >> src >> dest;             // the src (source) and dest (destination) node pair (edge) is read
-        adj_list[src].push_back(dest); // append the neighbour to the list of adjacent nodes
-        adj_list[dest].push_back(src); // append the neighbour to the list of adjacent nodes
-    };
+    // the graph is looked up in the cache (before it's compressed, since the hash is calculated from the CSR)
+    string hash; // content hash of the graph, to find it in the cache
+    node_eff::CachedResult cached;
+    bool cache_hit = false;
+    std::chrono::duration<double> lookup_seconds(0);
+    if (!cache_directory.empty())
+    {
+        auto lookup_start = std::chrono::system_clock::now();
+        hash = node_eff::graph_hash(graph);
+        cache_hit = node_eff::cache_load(cache_directory, hash, cached);
+        lookup_seconds = std::chrono::system_clock::now() - lookup_start;
+    }
 
-    vector<double> eff_list(N, 0); // stores the efficiency of each node
+    if (compressed && !cache_hit)
+    {
+        if (!cache_directory.empty()) // the CSR was built for the hash
+        {
+            compressed_graph = node_eff::compress(graph);
+            graph = node_eff::Graph(); // only the compressed graph is kept in memory
+        }
+        double num_edges = compressed_graph.num_neighbours / 2.;
+        double csr_bytes = (N + 1) * sizeof(int64_t) + compressed_graph.num_neighbours * sizeof(int);
+        cout << "bytes per edge: " << compressed_graph.memory_bytes() / num_edges
+             << " (uncompressed: " << csr_bytes / num_edges << ")" << endl;
+    }
 
     // for registering the time:
     cout << output_file << "'s time to determine the efficiency (in seconds) is:" << endl;
     std::chrono::time_point<std::chrono::system_clock> start, end;
     start = std::chrono::system_clock::now();
 
-// PARALLEL IMPLEMENTATION WITH OMP
-// It's done using pragma omp parallel for, with explicit shared objects:
-// adj_list: read only
-// N: read onlu
-// eff_list: to write the eff values on. It's expected that the pre-implemented "omp for" protocol will split the range of the for into
-// well distribuited continuous chuncks, minimizing the false sharing of this object.
-// private variables such as i,j,dist_from_src and eff are defined for each thread.
-#pragma omp parallel for default(none) shared(adj_list, N, eff_list) num_threads(num_threads)
-    for (int i = 0; i < N; i++) // for every node:
+    // PARALLEL IMPLEMENTATION WITH OMP
+    // the "omp parallel for" over the nodes is done inside node_eff::efficiency (node_eff.cpp),
+    // which must be compiled with -fopenmp as well.
+    vector<double> eff_list;                  // stores the efficiency of each node
+    vector<node_eff::NodeEfficiency> answer;  // stores the nodes found by the query
+    node_eff::QueryStats stats;
+    node_eff::NumaReport numa_report;
+    if (cache_hit)
     {
-        vector<int> dist_from_src(N, INT_MAX);               // stores the distances from src to node = index
-        breadth_first_search(adj_list, i, N, dist_from_src); // gets the distance from node i to all the nodes
-        double eff(0);                                       // stores de efficiency of the node i
-
-        for (int j = 0; j < N; j++) // for each neighbour:
-        // here we have spacial locality between the distances allocated in the dist_from_src vector
+        eff_list = move(cached.eff);
+    }
+    else if (!cache_directory.empty()) // the levels of every node are kept with the efficiencies
+    {
+        cached.eff.resize(N);
+        if (compressed)
         {
-            if (i != j && dist_from_src[j] != INT_MAX)  // if it's not the source node itself, neither isolated:
-            {                                           // here we have temporal locality of accessing eff_list[i] several times.
-                eff += 1. / dist_from_src[j] / (N - 1); // increment the efficiency
-            }
+            node_eff::efficiency_and_levels(compressed_graph, 0, N, num_threads, cached.eff.data(), cached.levels);
         }
-        eff_list[i] = eff; // the value of eff is transfered to the global eff_list vector
+        else
+        {
+            node_eff::efficiency_and_levels(graph, 0, N, num_threads, cached.eff.data(), cached.levels);
+        }
+        eff_list = cached.eff;
+    }
+    else if (numa_mode != node_eff::NumaMode::off)
+    {
+        eff_list = node_eff::efficiency_numa(graph, num_threads, numa_mode, &numa_report);
+    }
+    else if (truncated)
+    {
+        eff_list.resize(N);
+        if (compressed)
+        {
+            node_eff::truncated_efficiency(compressed_graph, 0, N, num_threads, max_depth, tail_estimate, eff_list.data());
+        }
+        else
+        {
+            node_eff::truncated_efficiency(graph, 0, N, num_threads, max_depth, tail_estimate, eff_list.data());
+        }
+    }
+    else if (compressed)
+    {
+        eff_list = node_eff::efficiency(compressed_graph, num_threads);
+    }
+    else if (query.empty())
+    {
+        eff_list = node_eff::efficiency(graph, num_threads);
+    }
+    else if (query == "--top-k")
+    {
+        answer = node_eff::top_k(graph, (int)query_value, num_threads, &stats);
     }
+    else
+    {
+        answer = node_eff::above_threshold(graph, query_value, num_threads, &stats);
+    }
+
     // getting the duration:
     end = std::chrono::system_clock::now();
     std::chrono::duration<double> elapsed_seconds = end - start;
     cout << elapsed_seconds.count() << endl;
-
-    // saving time into file
-    ofstream timefile(output_time);
-    timefile << setprecision(6) << fixed; // set 6 decimal places
-    if (timefile.is_open())
+    if (!query.empty())
     {
-        timefile << elapsed_seconds.count() << endl;
+        cout << answer.size() << " nodes found; searches completed: " << stats.completed
+             << ", stopped early: " << stats.pruned << ", skipped: " << stats.skipped << endl;
     }
-    timefile.close();
 
-    // after the eff_list is completely filled, it's content is written to the output_file
-    ofstream myfile(output_file);
-    for (int i = 0; i < N; i++)
+    if (!cache_directory.empty())
     {
-        myfile << std::setprecision(6) << std::fixed; // set 6 decimal places
+        if (cache_hit)
+        {
+            cout << "cache: hit (" << hash << "), found in " << lookup_seconds.count() << " s" << endl;
+        }
+        else if (node_eff::cache_store(cache_directory, hash, cached, (uint64_t)(cache_size * 1024 * 1024)))
+        {
+            cout << "cache: miss, result saved (" << hash << ")" << endl;
+        }
+        else
+        {
+            cout << "cache: miss, the result couldn't be saved to " << cache_directory << endl;
+        }
+    }
 
-        if (myfile.is_open())
+    if (numa_mode != node_eff::NumaMode::off)
+    {
+        cout << "NUMA nodes: " << numa_report.nodes
+             << (numa_report.applied ? "" : " (placement not applied: single node, CPUs of unknown node or compiled without -DNODE_EFF_NUMA)") << endl;
+        if (numa_report.local_allocations >= 0)
         {
-            myfile << eff_list[i] << endl;
+            cout << "pages allocated during the calculation, local: " << numa_report.local_allocations
+                 << ", remote: " << numa_report.remote_allocations << endl;
         }
     }
-    myfile.close();
+
+    // saving time into file (not on a cache hit: nothing was calculated, and the file is used for benchmarks)
+    if (!cache_hit)
+    {
+        node_eff::write_time(output_time, elapsed_seconds.count());
+    }
+
+    // after the eff_list is completely filled, it's content is written to the output_file
+    if (query.empty())
+    {
+        node_eff::write_eff(output_file, eff_list);
+    }
+    else
+    {
+        node_eff::write_query(output_file, answer);
+    }
 }
 
 /*
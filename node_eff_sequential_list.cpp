@@ -15,22 +15,25 @@
 * To execute the BFS, it is more convenient and efficient to have the list of adjacent nodes for every node (instead of
 * having to loop over the sparse adjacency matrix or the badly structured edge list), therefor we use the
 * adjacency list to store the graph data.
+
+* The .edgelist file is read and the .eff file is written by libnodeeff (node_eff.h).
 */
 
 #include <climits> //to use INT_MAX
 #include <vector>
 #include <list>
 #include <string>
-#include <sstream>  // for string stream
 #include <iostream> // for data mannagement
 #include <fstream>  // for file mannagement
-#include <iomanip>  // for setting the precision
 #include <chrono>   // for monitoring the elapsed time
+#include "node_eff.h"
 
 using namespace std;
 
-// adj_list is used as a costant reference to evoid copying
-void breadth_first_search(const vector<vector<int>> &adj_list, int src, int N, vector<int> &dist)
+// the graph is used as a costant reference to evoid copying
+// this is the first implementation of the search, kept with the list queue for comparison:
+// libnodeeff (node_eff::breadth_first_search) uses a vector as queue, which is approx. 2 times faster.
+void breadth_first_search(const node_eff::Graph &graph, int src, int N, vector<int> &dist)
 {
     list<int> queue;                // list of nodes not evaluated yet
     vector<bool> visited(N, false); // each position represents each node, it stores if the node was visited at least once
@@ -45,14 +48,15 @@ void breadth_first_search(const vector<vector<int>> &adj_list, int src, int N, v
         int node = queue.front(); // the first node is chosen
         queue.pop_front();        // and it is removed from the queue
 
-        for (unsigned int i = 0; i < adj_list[node].size(); i++) // for each index of neighbour
-        // here we have spacial locality by accessing the adj_list[node] entries, allocated sequencially
+        for (int64_t k = graph.offsets[node]; k < graph.offsets[node + 1]; k++) // for each index of neighbour
+        // here we have spacial locality by accessing the neighbours, allocated sequencially
         {
-            if (visited[adj_list[node][i]] == false) // if it's not been visited:
+            int neighbour = graph.neighbours[k];
+            if (visited[neighbour] == false) // if it's not been visited:
             {
-                visited[adj_list[node][i]] = true;        // update to visited
-                dist[adj_list[node][i]] = dist[node] + 1; // +1 step distance to the neighbour adj_list[node][i]
-                queue.push_back(adj_list[node][i]);       // add to the queue
+                visited[neighbour] = true;        // update to visited
+                dist[neighbour] = dist[node] + 1; // +1 step distance to the neighbour
+                queue.push_back(neighbour);       // add to the queue
             }
         }
     }
@@ -75,38 +79,15 @@ int main(int argc, char *argv[])
     }
 
     // if there is no error,
-    // firstly, the number of edges read.
-    int N; // the number of edges is read from the .edgelist file name "???_n_'N'_k_'?_?'.edgelist"
-    vector<string> split_file_name;
-    stringstream s_stream(argv[1]); // string stream object
-    while (s_stream.good())
-    {
-        string substr;
-        getline(s_stream, substr, '_'); // splits the filename at "_"
-        split_file_name.push_back(substr);
-    }
-
-    N = stoi(split_file_name[2]); // the N is the [2]th element
+    // the number of nodes read.
+    int N = node_eff::node_count_from_filename(argv[1]); // N is read from the .edgelist file name "???_n_'N'_k_'?_?'.edgelist"
 
     // creating the .eff filename to use later
-    string output_file;
-    output_file = argv[1];
-    size_t pos = output_file.find(".");
-    output_file = output_file.substr(0, pos);
-    output_file += ".eff";
-
-    // the adjacency list (vector of vector of int) will be created
-    vector<vector<int>> adj_list(N);
+    string output_file = node_eff::output_prefix(argv[1]) + ".eff";
 
-    string line;
-    while (getline(file, line)) // for each line in the edgelist file,
-    {
-        int src, dest;
-        istringstream ss(line);
-        ss >> src >> dest;             // the src (source) and dest (destination) node pair (edge) is read
-        adj_list[src].push_back(dest); // append the neighbourt to the list of adjacent nodes
-        adj_list[dest].push_back(src); // append the neighbourt to the list of adjacent nodes
-    };
+    // the graph (CSR adjacency) is created from the edge list
+    vector<int> flat_edgelist = node_eff::read_edgelist(file);
+    node_eff::Graph graph = node_eff::graph_from_edges(N, flat_edgelist.data(), flat_edgelist.size() / 2);
 
     vector<double> eff_list(N, 0); // stores the efficiency of each noed
 
@@ -117,7 +98,7 @@ int main(int argc, char *argv[])
     for (int i = 0; i < N; i++) // for every node:
     {
         vector<int> dist_from_src(N, INT_MAX);               // stores the distances from src to node = index
-        breadth_first_search(adj_list, i, N, dist_from_src); // gets the distance from node i to all the nodes
+        breadth_first_search(graph, i, N, dist_from_src);    // gets the distance from node i to all the nodes
 
         for (int j = 0; j < N; j++) // for each neighbour:
         // here we have spacial locallity between the distances allocated in the dist_from_src vector
@@ -134,17 +115,7 @@ int main(int argc, char *argv[])
     cout << elapsed_seconds.count() << endl;
 
     // after the eff_list is completely filled, it's content is writen to the output_file
-    ofstream myfile(output_file);
-    for (int i = 0; i < N; i++)
-    {
-        myfile << std::setprecision(6) << std::fixed; // set 6 decimal places
-
-        if (myfile.is_open())
-        {
-            myfile << eff_list[i] << endl;
-        }
-    }
-    myfile.close();
+    node_eff::write_eff(output_file, eff_list);
 }
 
 /*
@@ -0,0 +1,600 @@
+/*
+* @author Roberto Hiroshi Matos Furuta
+* Contact: roberto.furuta@usp.br
+
+* Resident version of the efficiency programs: it loads the graphs once and keeps them in memory (as CSR, see node_eff.h),
+* answering requests over a local (Unix domain) socket, so that many small questions about the same graphs
+* don't each pay for reading the .edgelist file and starting the threads.
+
+* Every request is one line of text:
+*     graphs                            the graphs held, "name N edges" per line
+*     load NAME FILE                    reads an .edgelist file (N taken from its name, as in the other programs) as the graph NAME
+*     eff NAME                          efficiency of every node
+*     nodes NAME V1 V2 ...              efficiency of the nodes V1, V2, ...
+*     sample NAME S [SEED]              estimate of the efficiency of every node from S nodes chosen at random (see node_eff::sampled_efficiency)
+*     update NAME add|remove U V ...    adds or removes the edges (U, V), ..., then the efficiency of every node of the new graph
+*     shutdown                          stops the server
+* and is answered by "ok LINES LATENCY BATCH" followed by LINES lines ("node efficiency" for the efficiencies),
+* or by a single line "error MESSAGE". LATENCY is the time in seconds from the arrival of the request to its answer,
+* and BATCH the number of requests that were served together with it.
+
+* All the calculations are done by a single thread (the main one), so the OpenMP threads it starts are kept for all the requests.
+* Each connection has its own thread, which only reads the requests and writes the answers: the requests that
+* arrive while a batch is being calculated are served together in the next batch, and the searches they need
+* are merged: each node is searched only once, by the 64 source searches of node_eff::efficiency_of_nodes.
+* The efficiencies found are kept until the graph changes, and an update only recalculates the nodes whose distances
+* may have changed: adding the edge (U, V) changes the distances from a node only if its distances to U and V
+* differ by 2 or more, and removing it only if they differ at all (otherwise the edge isn't in any of its shortest paths).
+*/
+
+#include <iostream> // for data mannagement
+#include <fstream>  // for file mannagement
+#include <sstream>  // for string stream
+#include <iomanip>  // for setting the precision
+#include <chrono>   // for monitoring the latency
+#include <climits>  // to use INT_MAX
+#include <cstdlib>  // for abs
+#include <stdexcept>
+#include <map>
+#include <numeric>  // for iota
+#include <memory>
+#include <deque>
+#include <future>   // for the answer of each request
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <csignal>  // for ignoring SIGPIPE
+#include <sys/socket.h>
+#include <sys/stat.h> // for lstat
+#include <sys/un.h>
+#include <unistd.h>
+#include "node_eff.h"
+
+using namespace std;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// a graph held by the server, with the efficiencies already calculated for it
+struct ResidentGraph
+{
+    node_eff::Graph graph;
+    vector<double> eff; // eff[i] is only valid if known[i]
+    vector<char> known;
+};
+
+// a request received by a connection thread, waiting for its answer
+struct Request
+{
+    string line;
+    vector<string> words;
+    Clock::time_point received;
+    promise<string> answer;
+};
+
+// the requests received and not yet taken by the main thread
+struct RequestQueue
+{
+    mutex lock;
+    condition_variable arrived;
+    deque<shared_ptr<Request>> requests;
+    int unanswered = 0; // requests whose answer was not written to the socket yet
+    condition_variable written;
+};
+
+// a request of a batch which is answered after the searches of its graph are done
+struct Pending
+{
+    shared_ptr<Request> request;
+    vector<int> nodes; // the nodes asked ("eff" and "update" ask for all of them)
+    int samples = 0;   // for "sample"
+    uint64_t seed = 0;
+};
+
+vector<string> split(const string &line)
+{
+    vector<string> words;
+    stringstream s_stream(line);
+    string word;
+    while (s_stream >> word)
+    {
+        words.push_back(word);
+    }
+    return words;
+}
+
+int to_node(const string &word, int N)
+{
+    size_t used = 0;
+    int node = stoi(word, &used);
+    if (used != word.size() || node < 0 || node >= N)
+    {
+        throw invalid_argument("node " + word + " is not in [0, " + to_string(N) + ")");
+    }
+    return node;
+}
+
+ResidentGraph load_graph(const string &filename)
+{
+    ifstream file(filename);
+    if (!file.is_open())
+    {
+        throw invalid_argument("can't open the file " + filename);
+    }
+    int N = node_eff::node_count_from_filename(filename);
+    vector<int> flat_edgelist = node_eff::read_edgelist(file);
+    ResidentGraph resident;
+    resident.graph = node_eff::graph_from_edges(N, flat_edgelist.data(), flat_edgelist.size() / 2);
+    resident.eff.assign(N, 0);
+    resident.known.assign(N, 0);
+    return resident;
+}
+
+// the name of a graph loaded from the command line: the file name without directory and ".edgelist"
+string graph_name(const string &filename)
+{
+    string prefix = node_eff::output_prefix(filename);
+    return prefix.substr(prefix.find_last_of('/') + 1);
+}
+
+// the same graph with the edge (u, v) added or removed (in both directions)
+node_eff::Graph change_edge(const node_eff::Graph &graph, int u, int v, bool add)
+{
+    node_eff::Graph changed;
+    changed.N = graph.N;
+    changed.offsets.assign(graph.N + 1, 0);
+    changed.neighbours.reserve(graph.neighbours.size() + 2);
+    for (int node = 0; node < graph.N; node++)
+    {
+        for (int64_t k = graph.offsets[node]; k < graph.offsets[node + 1]; k++)
+        {
+            int neighbour = graph.neighbours[k];
+            if (add || !((node == u && neighbour == v) || (node == v && neighbour == u)))
+            {
+                changed.neighbours.push_back(neighbour);
+            }
+        }
+        if (add && (node == u || node == v))
+        {
+            changed.neighbours.push_back(node == u ? v : u);
+        }
+        changed.offsets[node + 1] = changed.neighbours.size();
+    }
+    if (!add && changed.neighbours.size() == graph.neighbours.size())
+    {
+        throw invalid_argument("the edge (" + to_string(u) + ", " + to_string(v) + ") is not in the graph");
+    }
+    return changed;
+}
+
+// applies the "add|remove U V ..." of an update, forgetting the efficiencies that may have changed.
+// returns the number of nodes forgotten. Nothing is changed if the update is not valid.
+int apply_update(ResidentGraph &resident, const vector<string> &words)
+{
+    if (words.size() < 5 || (words.size() - 2) % 3 != 0)
+    {
+        throw invalid_argument("use: update NAME add|remove U V [add|remove U V ...]");
+    }
+    node_eff::Graph graph = resident.graph;
+    vector<char> known = resident.known;
+    node_eff::BfsWorkspace from_u(graph.N), from_v(graph.N);
+    for (size_t w = 2; w < words.size(); w += 3)
+    {
+        if (words[w] != "add" && words[w] != "remove")
+        {
+            throw invalid_argument("unknown change " + words[w] + ", use add or remove");
+        }
+        bool add = words[w] == "add";
+        int u = to_node(words[w + 1], graph.N), v = to_node(words[w + 2], graph.N);
+        if (u == v) // a self loop doesn't change any distance
+        {
+            continue;
+        }
+
+        // the distances before the change decide which nodes are affected
+        node_eff::breadth_first_search(graph, u, from_u);
+        node_eff::breadth_first_search(graph, v, from_v);
+        for (const node_eff::BfsWorkspace *reached : {&from_u, &from_v})
+        {
+            for (int k = 0; k < reached->reached; k++) // only the nodes connected to u or v can be affected
+            {
+                int node = reached->queue[k];
+                int to_u = from_u.dist[node], to_v = from_v.dist[node];
+                bool affected = add ? (to_u == INT_MAX || to_v == INT_MAX || abs(to_u - to_v) >= 2) : to_u != to_v;
+                if (affected)
+                {
+                    known[node] = 0;
+                }
+            }
+        }
+        graph = change_edge(graph, u, v, add);
+    }
+
+    int forgotten = 0;
+    for (int i = 0; i < graph.N; i++)
+    {
+        forgotten += resident.known[i] && !known[i];
+    }
+    resident.graph = move(graph);
+    resident.known = move(known);
+    return forgotten;
+}
+
+// "node efficiency" per line, with 6 decimal places, as in the .query files
+string efficiency_lines(const vector<int> &nodes, const vector<double> &eff)
+{
+    stringstream lines;
+    lines << fixed << setprecision(6);
+    for (int node : nodes)
+    {
+        lines << node << " " << eff[node] << "\n";
+    }
+    return lines.str();
+}
+
+class Server
+{
+public:
+    explicit Server(int num_threads) : num_threads(num_threads) {}
+
+    map<string, ResidentGraph> graphs;
+    bool stopping = false;
+
+    // serves every request of a batch, in the order they arrived
+    void serve(const vector<shared_ptr<Request>> &batch)
+    {
+        batch_size = batch.size();
+        for (const shared_ptr<Request> &request : batch)
+        {
+            try
+            {
+                take(request);
+            }
+            catch (const exception &e)
+            {
+                fail(*request, e.what());
+            }
+        }
+        for (auto &entry : pending)
+        {
+            flush(entry.first);
+        }
+        pending.clear();
+    }
+
+private:
+    int num_threads;
+    size_t batch_size = 0;
+    map<string, vector<Pending>> pending; // the requests of the batch waiting for the searches of each graph
+
+    ResidentGraph &find(const vector<string> &words)
+    {
+        if (words.size() < 2 || graphs.count(words[1]) == 0)
+        {
+            throw invalid_argument(words.size() < 2 ? "the graph name is missing" : "unknown graph " + words[1]);
+        }
+        return graphs[words[1]];
+    }
+
+    // answers a request right away, or leaves it pending until the searches of its graph are done
+    void take(const shared_ptr<Request> &request)
+    {
+        const vector<string> &words = request->words;
+        const string &command = words[0];
+        if (command == "graphs")
+        {
+            stringstream lines;
+            for (const auto &entry : graphs)
+            {
+                lines << entry.first << " " << entry.second.graph.N << " " << entry.second.graph.neighbours.size() / 2 << "\n";
+            }
+            respond(*request, lines.str(), graphs.size());
+        }
+        else if (command == "shutdown")
+        {
+            stopping = true;
+            respond(*request, "", 0);
+        }
+        else if (command == "load" && words.size() == 3)
+        {
+            ResidentGraph loaded = load_graph(words[2]);
+            flush(words[1]); // the requests before the load are answered with the old graph
+            graphs[words[1]] = move(loaded);
+            respond(*request, "", 0);
+        }
+        else if (command == "eff" && words.size() == 2)
+        {
+            ResidentGraph &resident = find(words);
+            Pending all{request, vector<int>(resident.graph.N)};
+            iota(all.nodes.begin(), all.nodes.end(), 0);
+            pending[words[1]].push_back(move(all));
+        }
+        else if (command == "nodes" && words.size() >= 3)
+        {
+            ResidentGraph &resident = find(words);
+            Pending asked{request, {}};
+            for (size_t w = 2; w < words.size(); w++)
+            {
+                asked.nodes.push_back(to_node(words[w], resident.graph.N));
+            }
+            pending[words[1]].push_back(move(asked));
+        }
+        else if (command == "sample" && (words.size() == 3 || words.size() == 4))
+        {
+            find(words);
+            Pending sample{request, {}};
+            sample.samples = stoi(words[2]);
+            sample.seed = words.size() == 4 ? stoull(words[3]) : 0;
+            if (sample.samples < 1)
+            {
+                throw invalid_argument("the number of samples must be at least 1");
+            }
+            pending[words[1]].push_back(move(sample));
+        }
+        else if (command == "update")
+        {
+            ResidentGraph &resident = find(words);
+            flush(words[1]); // the requests before the update are answered with the old graph
+            int forgotten = apply_update(resident, words);
+            cout << "update " << words[1] << ": " << forgotten << " efficiencies to recalculate" << endl;
+            Pending all{request, vector<int>(resident.graph.N)};
+            iota(all.nodes.begin(), all.nodes.end(), 0);
+            pending[words[1]].push_back(move(all));
+        }
+        else
+        {
+            throw invalid_argument("unknown request: " + request->line);
+        }
+    }
+
+    // does the searches needed by the pending requests of a graph, all together, and answers them
+    void flush(const string &name)
+    {
+        vector<Pending> &requests = pending[name];
+        if (requests.empty())
+        {
+            return;
+        }
+        ResidentGraph &resident = graphs[name];
+        auto start = Clock::now();
+
+        vector<string> answers; // the answers are only sent once everything is calculated
+        try
+        {
+            vector<int> missing; // the nodes asked whose efficiency is not known, each one once
+            vector<char> queued(resident.graph.N, 0);
+            for (const Pending &waiting : requests)
+            {
+                for (int node : waiting.nodes)
+                {
+                    if (!resident.known[node] && !queued[node])
+                    {
+                        queued[node] = 1;
+                        missing.push_back(node);
+                    }
+                }
+            }
+            vector<double> found(missing.size());
+            node_eff::efficiency_of_nodes(resident.graph, missing.data(), missing.size(), num_threads, found.data());
+            for (size_t k = 0; k < missing.size(); k++)
+            {
+                resident.eff[missing[k]] = found[k];
+                resident.known[missing[k]] = 1;
+            }
+            chrono::duration<double> seconds = Clock::now() - start;
+            cout << name << ": " << requests.size() << " requests, " << missing.size() << " searches in " << seconds.count() << " s" << endl;
+
+            vector<int> all(resident.graph.N);
+            iota(all.begin(), all.end(), 0);
+            for (const Pending &waiting : requests)
+            {
+                if (waiting.samples > 0)
+                {
+                    answers.push_back(efficiency_lines(all, node_eff::sampled_efficiency(resident.graph, waiting.samples, waiting.seed, num_threads)));
+                }
+                else
+                {
+                    answers.push_back(efficiency_lines(waiting.nodes, resident.eff));
+                }
+            }
+        }
+        catch (const exception &e)
+        {
+            for (Pending &waiting : requests)
+            {
+                fail(*waiting.request, e.what());
+            }
+            requests.clear();
+            return;
+        }
+
+        for (size_t r = 0; r < requests.size(); r++)
+        {
+            int num_lines = requests[r].samples > 0 ? resident.graph.N : requests[r].nodes.size();
+            respond(*requests[r].request, answers[r], num_lines);
+        }
+        requests.clear();
+    }
+
+    void respond(Request &request, const string &lines, size_t num_lines)
+    {
+        chrono::duration<double> latency = Clock::now() - request.received;
+        request.answer.set_value("ok " + to_string(num_lines) + " " + to_string(latency.count()) + " " + to_string(batch_size) + "\n" + lines);
+        cout << request.line.substr(0, 60) << ": " << latency.count() << " s" << endl;
+    }
+
+    void fail(Request &request, const string &message)
+    {
+        request.answer.set_value("error " + message + "\n");
+        cout << request.line.substr(0, 60) << ": error " << message << endl;
+    }
+};
+
+// removes the socket file at path; anything else found there (e.g. an .edgelist file given in the wrong order) is kept.
+// returns false if path exists and is not a socket.
+bool remove_socket(const string &path)
+{
+    struct stat status;
+    if (lstat(path.c_str(), &status) != 0)
+    {
+        return true; // nothing there
+    }
+    if (!S_ISSOCK(status.st_mode))
+    {
+        return false;
+    }
+    unlink(path.c_str());
+    return true;
+}
+
+bool write_all(int socket_fd, const string &data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t count = write(socket_fd, data.data() + written, data.size() - written);
+        if (count <= 0)
+        {
+            return false;
+        }
+        written += count;
+    }
+    return true;
+}
+
+// reads the requests of one connection, one per line, and writes their answers
+void serve_connection(int socket_fd, RequestQueue &queue)
+{
+    string buffer;
+    char chunk[4096];
+    ssize_t count;
+    bool open = true;
+    while (open && (count = read(socket_fd, chunk, sizeof(chunk))) > 0)
+    {
+        buffer.append(chunk, count);
+        size_t end;
+        while (open && (end = buffer.find('\n')) != string::npos)
+        {
+            auto request = make_shared<Request>();
+            request->received = Clock::now();
+            request->line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!request->line.empty() && request->line.back() == '\r')
+            {
+                request->line.pop_back();
+            }
+            request->words = split(request->line);
+            if (request->words.empty())
+            {
+                continue;
+            }
+
+            future<string> answer = request->answer.get_future();
+            {
+                lock_guard<mutex> guard(queue.lock);
+                queue.requests.push_back(request);
+                queue.unanswered++;
+            }
+            queue.arrived.notify_one();
+            open = write_all(socket_fd, answer.get());
+            {
+                lock_guard<mutex> guard(queue.lock);
+                queue.unanswered--;
+            }
+            queue.written.notify_one();
+        }
+    }
+    close(socket_fd);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Reads the program name, the socket path and the number of threads from the terminal,
+    // optionally followed by .edgelist files to load at the start (each one named by its file name without ".edgelist")
+    if (argc < 3)
+    {
+        cerr << "Give in the command line the socket path and the number of threads, optionally followed by .edgelist files to load.\n";
+        return 1;
+    }
+    string socket_path = argv[1];
+    int num_threads = stoi(argv[2]);
+
+    Server server(num_threads);
+    for (int a = 3; a < argc; a++)
+    {
+        try
+        {
+            server.graphs[graph_name(argv[a])] = load_graph(argv[a]);
+            cout << "loaded " << graph_name(argv[a]) << endl;
+        }
+        catch (const exception &e)
+        {
+            cerr << e.what() << endl;
+            return 2;
+        }
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        cerr << "The socket path is too long.\n";
+        return 1;
+    }
+    socket_path.copy(address.sun_path, socket_path.size());
+    if (!remove_socket(socket_path)) // a socket left by a previous server that didn't stop cleanly is removed
+    {
+        cerr << socket_path << " exists and is not a socket; give the socket path first, then the number of threads.\n";
+        return 1;
+    }
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || bind(listen_fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, 64) != 0)
+    {
+        cerr << "Error opening the socket " << socket_path << endl;
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN); // a client that leaves before its answer must not stop the server
+
+    // the OpenMP threads are started now, and kept by the OpenMP runtime for all the calculations of this thread
+#pragma omp parallel num_threads(num_threads)
+    {
+    }
+
+    RequestQueue queue;
+    thread acceptor([&] {
+        int client_fd;
+        while ((client_fd = accept(listen_fd, nullptr, nullptr)) >= 0)
+        {
+            thread(serve_connection, client_fd, ref(queue)).detach();
+        }
+    });
+    cout << "listening on " << socket_path << endl;
+
+    while (!server.stopping)
+    {
+        vector<shared_ptr<Request>> batch; // every request that arrived while the previous batch was calculated
+        {
+            unique_lock<mutex> guard(queue.lock);
+            queue.arrived.wait(guard, [&] { return !queue.requests.empty(); });
+            batch.assign(queue.requests.begin(), queue.requests.end());
+            queue.requests.clear();
+        }
+        server.serve(batch);
+    }
+
+    {
+        // the answers of the last batch (the shutdown included) are written before the program ends
+        unique_lock<mutex> guard(queue.lock);
+        queue.written.wait_for(guard, chrono::seconds(1), [&] { return queue.unanswered == 0; });
+    }
+
+    shutdown(listen_fd, SHUT_RDWR); // makes accept return
+    acceptor.join();
+    close(listen_fd);
+    remove_socket(socket_path);
+    return 0;
+}
@@ -0,0 +1,700 @@
+/*
+* @author Roberto Hiroshi Matos Furuta
+* Contact: roberto.furuta@usp.br
+
+* Validation of the efficiencies, in two modes:
+
+* - comparison of two output files (e.g. an .eff file against the expected one):
+*       node_eff_validate RESULT [EXPECTED] [--abs A] [--rel R] [--ulp U] [--worst K] [--threads T]
+*   without EXPECTED, it's "expected_RESULT" (in the same directory), as in the old compare-expected-trab-1.
+*   Both files are mapped in memory and parsed in parallel (each thread parses its own part of the file),
+*   and compared in a single vectorized (omp simd) loop.
+
+* - comparison of an engine of libnodeeff against the sequential calculation, on generated graphs:
+*       node_eff_validate --engine ENGINE [--graphs G] [--nodes N] [--seed S] [--threads T] [--abs A] [--rel R] [--ulp U] [--worst K]
+*   ENGINE is one of: parallel (node_eff::efficiency with T threads), nodes (node_eff::efficiency_of_nodes),
+*   compressed (node_eff::CompressedGraph), batches (node_eff::efficiency_batches), sample:S (node_eff::sampled_efficiency
+*   with S samples), depth:K (node_eff::truncated_efficiency with the tail estimate, compared with the sequential
+*   truncated efficiency: the complete search cut at distance K, plus the tail estimate), top-k:K (node_eff::top_k) or
+*   threshold:T (node_eff::above_threshold). The sequential calculation is a plain BFS of its own, which doesn't share
+*   any code with the library. The graphs alternate between Barabási–Albert graphs (as the .edgelist files studied)
+*   and sparse random graphs with several components.
+
+* A value is within the tolerance if its absolute error is <= A, or its relative error is <= R, or it's at most U
+* representable doubles (units in the last place, ULP) away from the expected value. By default A = 1e-5 (as in
+* compare-expected-trab-1), R = 0 and U = 0. Instead of stopping at the first difference, the whole distribution of the
+* errors is reported: the maximum and mean errors, the number of values out of the tolerance, the number of values by
+* order of magnitude of the error, and the K values with the largest errors (5 by default).
+* The exit code is 0 if every value is within the tolerance, 3 otherwise (or if the files have different sizes).
+
+* The floating point numbers are parsed with std::from_chars, which needs GCC 11 or newer.
+*/
+
+#include <iostream> // for data mannagement
+#include <iomanip>  // for setting the precision
+#include <algorithm>
+#include <charconv> // for from_chars
+#include <climits>  // for INT_MAX
+#include <cmath>
+#include <cstring>  // for memcpy
+#include <functional>
+#include <limits>
+#include <numeric>  // for iota
+#include <random>   // for generating the graphs
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+#include "node_eff.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+
+// a file mapped (read only) in memory
+class MappedFile
+{
+public:
+    explicit MappedFile(const string &filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat status;
+        if (fd < 0 || fstat(fd, &status) != 0)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            throw runtime_error("Error opening file " + filename);
+        }
+        size = status.st_size;
+        if (size > 0)
+        {
+            void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                close(fd);
+                throw runtime_error("Error mapping file " + filename);
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(mapped);
+        }
+        close(fd); // the mapping stays valid
+    }
+
+    ~MappedFile()
+    {
+        if (data != nullptr)
+        {
+            munmap(const_cast<char *>(data), size);
+        }
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+int resolve_num_threads(int num_threads)
+{
+#ifdef _OPENMP
+    if (num_threads <= 0)
+    {
+        num_threads = omp_get_max_threads();
+    }
+#endif
+    return max(num_threads, 1);
+}
+
+// the numbers of a text file separated by white space (as read by istream_iterator<double>), parsed in parallel:
+// the file is split into one part per thread (each one starting at a white space, so that no number is split),
+// every thread counts the numbers of its part, and then parses them to their position in the vector.
+vector<double> parse_numbers(const string &filename, int num_threads)
+{
+    MappedFile file(filename);
+    const char *data = file.data;
+    size_t size = file.size;
+
+    int parts = resolve_num_threads(num_threads);
+    vector<size_t> begin(parts + 1, size);
+    begin[0] = 0;
+    for (int p = 1; p < parts; p++)
+    {
+        size_t pos = max(begin[p - 1], size * p / parts);
+        while (pos < size && !is_space(data[pos]))
+        {
+            pos++;
+        }
+        begin[p] = pos;
+    }
+
+    // a number starts where a non space character follows a space (or the start of the part)
+    vector<size_t> first(parts + 1, 0); // position in the vector of the first number of each part
+#pragma omp parallel for num_threads(parts)
+    for (int p = 0; p < parts; p++)
+    {
+        size_t count = 0;
+        for (size_t pos = begin[p]; pos < begin[p + 1]; pos++)
+        {
+            count += !is_space(data[pos]) && (pos == begin[p] || is_space(data[pos - 1]));
+        }
+        first[p + 1] = count;
+    }
+    partial_sum(first.begin(), first.end(), first.begin());
+
+    vector<double> numbers(first[parts]);
+    size_t bad = numeric_limits<size_t>::max(); // position in the file of the first number that couldn't be parsed
+#pragma omp parallel for num_threads(parts) reduction(min : bad)
+    for (int p = 0; p < parts; p++)
+    {
+        size_t index = first[p];
+        size_t pos = begin[p];
+        while (pos < begin[p + 1])
+        {
+            if (is_space(data[pos]))
+            {
+                pos++;
+                continue;
+            }
+            size_t end = pos;
+            while (end < begin[p + 1] && !is_space(data[end]))
+            {
+                end++;
+            }
+            from_chars_result result = from_chars(data + pos, data + end, numbers[index]);
+            if (result.ec != errc() || result.ptr != data + end)
+            {
+                bad = min(bad, pos);
+            }
+            index++;
+            pos = end;
+        }
+    }
+    if (bad != numeric_limits<size_t>::max())
+    {
+        size_t end = bad;
+        while (end < size && !is_space(data[end]))
+        {
+            end++;
+        }
+        throw runtime_error("Error reading " + filename + ": \"" + string(data + bad, data + end) + "\" is not a number");
+    }
+    return numbers;
+}
+
+// position of a double among all the doubles in increasing order, so that the difference between
+// two of them is the number of representable doubles between them (their distance in ULP)
+inline int64_t ordered(double value)
+{
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int64_t sign = bits >> 63; // -1 for the negative numbers, 0 for the others
+    // the negative numbers are in the inverse order of their bits: -bits without the sign bit, written without a branch
+    return (bits ^ (sign & numeric_limits<int64_t>::max())) - sign;
+}
+
+struct Tolerance
+{
+    double abs = 1e-5;
+    double rel = 0;
+    int64_t ulp = 0;
+};
+
+// errors of found against expected, element by element, and their summary
+struct Comparison
+{
+    vector<double> abs_error;
+    double max_abs = 0, max_rel = 0;
+    int64_t max_ulp = 0; // numeric_limits<int64_t>::max() for NaN or a distance too large to count
+    double sum_abs = 0;
+    int64_t over = 0; // number of values out of the tolerance
+};
+
+// the comparison is written without branches, so that it's vectorized (omp simd) besides being split over the threads.
+// (the ULP distance is kept as an integer, since converting int64_t to double is only vectorized with AVX-512:
+// with integers, AVX2 is enough)
+Comparison compare(const vector<double> &found, const vector<double> &expected, const Tolerance &tolerance, int num_threads)
+{
+    Comparison result;
+    int64_t size = expected.size();
+    result.abs_error.resize(size);
+    const double *found_data = found.data();
+    const double *expected_data = expected.data();
+    double *abs_error = result.abs_error.data();
+    double max_abs = 0, max_rel = 0, sum_abs = 0;
+    int64_t max_ulp = 0, over = 0;
+    const double infinity = numeric_limits<double>::infinity();
+    const int64_t farthest = numeric_limits<int64_t>::max();
+    double abs_tolerance = tolerance.abs, rel_tolerance = tolerance.rel;
+    int64_t ulp_tolerance = tolerance.ulp;
+    num_threads = resolve_num_threads(num_threads);
+
+#pragma omp parallel for simd num_threads(num_threads) reduction(max : max_abs, max_rel, max_ulp) reduction(+ : sum_abs, over)
+    for (int64_t i = 0; i < size; i++)
+    {
+        double a = found_data[i], e = expected_data[i];
+        double difference = a - e; // NaN if any of them is NaN, which counts as an infinite error
+        double error = std::isnan(difference) ? infinity : fabs(difference);
+        error = a == e ? 0 : error;
+        double rel = error == 0 ? 0 : error / fabs(e); // infinite if e == 0
+        rel = std::isnan(rel) ? infinity : rel; // (NaN - x, or inf / inf) NaN would pass the comparison with the tolerance
+        int64_t found_order = ordered(a), expected_order = ordered(e);
+        int64_t distance = (int64_t)((uint64_t)found_order - (uint64_t)expected_order); // wraps around if it overflows
+        int64_t overflow = (found_order ^ expected_order) & (found_order ^ distance); // negative if it did
+        distance = distance < 0 ? (int64_t)(0 - (uint64_t)distance) : distance;
+        int64_t ulp = (overflow < 0) | std::isnan(difference) ? farthest : distance;
+        ulp = a == e ? 0 : ulp;
+
+        abs_error[i] = error;
+        max_abs = max_abs > error ? max_abs : error;
+        max_rel = max_rel > rel ? max_rel : rel;
+        max_ulp = max_ulp > ulp ? max_ulp : ulp;
+        sum_abs += error;
+        over += (error > abs_tolerance) & (rel > rel_tolerance) & (ulp > ulp_tolerance);
+    }
+
+    result.max_abs = max_abs;
+    result.max_rel = max_rel;
+    result.max_ulp = max_ulp;
+    result.sum_abs = sum_abs;
+    result.over = over;
+    return result;
+}
+
+// prints the distribution of the errors; describe(i) names the element i in the list of the largest errors.
+// returns true if every value is within the tolerance.
+bool report(const vector<double> &found, const vector<double> &expected, const Tolerance &tolerance, int worst,
+            int num_threads, const function<string(int64_t)> &describe)
+{
+    Comparison comparison = compare(found, expected, tolerance, num_threads);
+    int64_t size = expected.size();
+    const vector<double> &abs_error = comparison.abs_error;
+
+    cout << size << " elements read.\n";
+    cout << "max abs error: " << comparison.max_abs << ", mean abs error: " << (size > 0 ? comparison.sum_abs / size : 0)
+         << ", max rel error: " << comparison.max_rel << ", max ULP distance: "
+         << (comparison.max_ulp == numeric_limits<int64_t>::max() ? "inf" : to_string(comparison.max_ulp)) << "\n";
+
+    // number of errors of each order of magnitude: 0, < 1e-15, [1e-15, 1e-14), ..., [0.1, 1), >= 1
+    const int lowest = -15;
+    vector<int64_t> count(2 - lowest + 1, 0);
+    for (double error : abs_error)
+    {
+        int bucket = error == 0 ? 0 : (int)min(max(floor(log10(error)), lowest - 1.), 0.) - lowest + 2;
+        count[bucket]++;
+    }
+    cout << "abs errors by order of magnitude:\n";
+    for (size_t bucket = 0; bucket < count.size(); bucket++)
+    {
+        if (count[bucket] == 0)
+        {
+            continue;
+        }
+        int exponent = (int)bucket + lowest - 2;
+        string range = bucket == 0 ? "0" : bucket == 1 ? "< 1e" + to_string(lowest) : exponent == 0 ? ">= 1" : "[1e" + to_string(exponent) + ", 1e" + to_string(exponent + 1) + ")";
+        cout << "    " << left << setw(18) << range + ":" << right;
+        cout << count[bucket] << "\n";
+    }
+
+    // the elements with the largest errors
+    vector<int64_t> largest;
+    for (int64_t i = 0; i < size; i++)
+    {
+        if (abs_error[i] > 0)
+        {
+            largest.push_back(i);
+        }
+    }
+    int64_t shown = min<int64_t>(worst, largest.size());
+    partial_sort(largest.begin(), largest.begin() + shown, largest.end(),
+                 [&](int64_t a, int64_t b) { return abs_error[a] > abs_error[b]; });
+    if (shown > 0)
+    {
+        cout << "largest errors:\n";
+        for (int64_t k = 0; k < shown; k++)
+        {
+            int64_t i = largest[k];
+            cout << "    " << describe(i) << ": expected " << setprecision(12) << expected[i] << ", found " << found[i]
+                 << setprecision(6) << " (abs error " << abs_error[i] << ")\n";
+        }
+    }
+
+    cout << comparison.over << " elements out of the tolerance (abs " << tolerance.abs << ", rel " << tolerance.rel
+         << ", ULP " << tolerance.ulp << ").\n";
+    return comparison.over == 0;
+}
+
+// Barabási–Albert graph: each new node is linked to m distinct nodes chosen with probability proportional to their degree
+vector<int> barabasi_albert(int N, int m, mt19937_64 &random)
+{
+    vector<int> edges;
+    vector<int> ends; // every node appears once for each edge it has, so choosing from it follows the degrees
+    vector<int> targets(m);
+    iota(targets.begin(), targets.end(), 0); // the first new node is linked to the m initial nodes
+    for (int node = m; node < N; node++)
+    {
+        for (int target : targets)
+        {
+            edges.push_back(node);
+            edges.push_back(target);
+            ends.push_back(node);
+            ends.push_back(target);
+        }
+        targets.clear();
+        while ((int)targets.size() < m)
+        {
+            int target = ends[uniform_int_distribution<size_t>(0, ends.size() - 1)(random)];
+            if (find(targets.begin(), targets.end(), target) == targets.end())
+            {
+                targets.push_back(target);
+            }
+        }
+    }
+    return edges;
+}
+
+// random graph with N edges between nodes chosen uniformly (mean degree 2), which has several components and isolated nodes
+vector<int> sparse_random(int N, mt19937_64 &random)
+{
+    vector<int> edges;
+    uniform_int_distribution<int> node(0, N - 1);
+    for (int e = 0; e < N; e++)
+    {
+        int src = node(random), dest = node(random);
+        if (src != dest)
+        {
+            edges.push_back(src);
+            edges.push_back(dest);
+        }
+    }
+    return edges;
+}
+
+// breadth first search from src, as in the first version of the programs (with its own adjacency list and visited flags),
+// so that the reference doesn't share any code with the search of the library it checks.
+// dist[j] gets the distance from src to j, INT_MAX if j is not reached
+void plain_breadth_first_search(const vector<vector<int>> &adj_list, int src, vector<int> &dist)
+{
+    int N = adj_list.size();
+    vector<int> queue;              // nodes in the order they were reached; queue[next ..] are not evaluated yet
+    vector<bool> visited(N, false); // each position represents each node, it stores if the node was visited at least once
+    fill(dist.begin(), dist.end(), INT_MAX);
+
+    visited[src] = true;
+    dist[src] = 0;
+    queue.push_back(src);
+    for (size_t next = 0; next < queue.size(); next++)
+    {
+        int node = queue[next];
+        for (int neighbour : adj_list[node])
+        {
+            if (!visited[neighbour])
+            {
+                visited[neighbour] = true;
+                dist[neighbour] = dist[node] + 1;
+                queue.push_back(neighbour);
+            }
+        }
+    }
+}
+
+// efficiency of src from its distances. With max_depth > 0, the truncated efficiency with the tail estimate: the nodes up to
+// max_depth, and every node reached farther as if it were at distance max_depth + 1.
+// the terms are added by distance, as in node_eff::efficiency_from_levels, so both can be compared exactly
+double reference_efficiency(const vector<int> &dist, int src, int max_depth)
+{
+    int N = dist.size();
+    vector<int64_t> count; // count[d]: number of nodes at distance d
+    int64_t farther = 0;   // number of nodes reached farther than max_depth
+    for (int j = 0; j < N; j++)
+    {
+        if (j == src || dist[j] == INT_MAX) // the source itself and the nodes not reached don't contribute
+        {
+            continue;
+        }
+        if (max_depth > 0 && dist[j] > max_depth)
+        {
+            farther++;
+            continue;
+        }
+        if (dist[j] >= (int)count.size())
+        {
+            count.resize(dist[j] + 1, 0);
+        }
+        count[dist[j]]++;
+    }
+    double eff = 0;
+    for (size_t d = 1; d < count.size(); d++)
+    {
+        eff += (double)count[d] / d / (N - 1);
+    }
+    if (farther > 0)
+    {
+        eff += (double)farther / (max_depth + 1) / (N - 1);
+    }
+    return eff;
+}
+
+// runs the engine under test on the graph. found gets what it calculated, expected what it should have calculated
+// (from reference, the sequential efficiency of every node) and label names each value for the list of the largest errors.
+// The engines give the efficiency of every node, except the queries (top-k:K and threshold:T), which give the efficiencies
+// of their answer by rank, compared with the largest reference efficiencies (missing or extra ranks are NaN, so they count as
+// errors), followed by the efficiency of each node of the answer, compared with its own reference efficiency.
+void run_engine(const string &engine, const node_eff::Graph &graph, int num_threads, uint64_t seed,
+                const vector<double> &reference, vector<double> &found, vector<double> &expected, vector<string> &label)
+{
+    size_t colon = engine.find(':');
+    string name = engine.substr(0, colon);
+    string value = colon == string::npos ? "" : engine.substr(colon + 1);
+    int parameter = value.empty() || name == "threshold" ? 0 : stoi(value);
+    vector<double> eff_list(graph.N);
+    if (name == "top-k" || name == "threshold")
+    {
+        double threshold = name == "threshold" ? stod(value) : 0;
+        if (value.empty() || parameter < 0)
+        {
+            throw invalid_argument("unknown engine " + engine + ", use top-k:K with K >= 0 or threshold:T");
+        }
+        vector<node_eff::NodeEfficiency> answer =
+            name == "top-k" ? node_eff::top_k(graph, parameter, num_threads) : node_eff::above_threshold(graph, threshold, num_threads);
+
+        vector<double> largest = reference;
+        sort(largest.begin(), largest.end(), greater<double>());
+        size_t ranks = name == "top-k" ? min<size_t>(parameter, largest.size())
+                                       : upper_bound(largest.begin(), largest.end(), threshold, greater<double>()) - largest.begin();
+        const double missing = numeric_limits<double>::quiet_NaN();
+        for (size_t r = 0; r < max(ranks, answer.size()); r++)
+        {
+            found.push_back(r < answer.size() ? answer[r].eff : missing);
+            expected.push_back(r < ranks ? largest[r] : missing);
+            label.push_back("rank " + to_string(r + 1));
+        }
+        for (const node_eff::NodeEfficiency &result : answer)
+        {
+            found.push_back(result.eff);
+            expected.push_back(reference[result.node]);
+            label.push_back("node " + to_string(result.node) + " of the answer");
+        }
+        return;
+    }
+
+    if (name == "parallel")
+    {
+        eff_list = node_eff::efficiency(graph, num_threads);
+    }
+    else if (name == "nodes")
+    {
+        vector<int> nodes(graph.N);
+        iota(nodes.begin(), nodes.end(), 0);
+        node_eff::efficiency_of_nodes(graph, nodes.data(), graph.N, num_threads, eff_list.data());
+    }
+    else if (name == "compressed")
+    {
+        eff_list = node_eff::efficiency(node_eff::compress(graph), num_threads);
+    }
+    else if (name == "batches")
+    {
+        node_eff::efficiency_batches(graph, num_threads, 100, [&](int first_node, int count, const double *eff) {
+            copy(eff, eff + count, eff_list.begin() + first_node);
+        });
+    }
+    else if (name == "sample" && parameter > 0)
+    {
+        eff_list = node_eff::sampled_efficiency(graph, parameter, seed, num_threads);
+    }
+    else if (name == "depth" && parameter > 0)
+    {
+        node_eff::truncated_efficiency(graph, 0, graph.N, num_threads, parameter, true, eff_list.data());
+    }
+    else
+    {
+        throw invalid_argument("unknown engine " + engine +
+                               ", use parallel, nodes, compressed, batches, sample:S, depth:K, top-k:K or threshold:T");
+    }
+    found.insert(found.end(), eff_list.begin(), eff_list.end());
+    expected.insert(expected.end(), reference.begin(), reference.end());
+    for (int i = 0; i < graph.N; i++)
+    {
+        label.push_back("node " + to_string(i));
+    }
+}
+
+// the engine against the sequential calculation, on num_graphs generated graphs of N nodes
+bool validate_engine(const string &engine, int num_graphs, int N, uint64_t seed, int num_threads, const Tolerance &tolerance, int worst)
+{
+    // the engine depth:K is checked against the truncated efficiency (with the tail estimate), all the others against the efficiency
+    int max_depth = engine.compare(0, 6, "depth:") == 0 ? stoi(engine.substr(6)) : 0;
+    mt19937_64 random(seed);
+    vector<double> found, expected; // the values of all the graphs, one graph after the other
+    vector<string> label;
+    for (int g = 0; g < num_graphs; g++)
+    {
+        bool scale_free = g % 2 == 0;
+        vector<int> edges = scale_free ? barabasi_albert(N, 2 + g % 5, random) : sparse_random(N, random);
+        node_eff::Graph graph = node_eff::graph_from_edges(N, edges.data(), edges.size() / 2);
+
+        // calculated sequentially, one plain breadth first search at a time, on an adjacency list built here from the edges
+        vector<vector<int>> adj_list(N);
+        for (size_t e = 0; e < edges.size(); e += 2)
+        {
+            adj_list[edges[e]].push_back(edges[e + 1]);
+            adj_list[edges[e + 1]].push_back(edges[e]);
+        }
+        vector<double> reference(N);
+        vector<int> dist(N);
+        for (int i = 0; i < N; i++)
+        {
+            plain_breadth_first_search(adj_list, i, dist);
+            reference[i] = reference_efficiency(dist, i, max_depth);
+        }
+
+        size_t first = found.size();
+        run_engine(engine, graph, num_threads, random(), reference, found, expected, label);
+        double max_error = 0;
+        for (size_t i = first; i < found.size(); i++)
+        {
+            double difference = fabs(found[i] - expected[i]);
+            max_error = std::isnan(difference) || difference > max_error ? difference : max_error;
+            label[i] = "graph " + to_string(g) + ", " + label[i];
+        }
+        cout << "graph " << g << " (" << (scale_free ? "Barabasi-Albert" : "sparse random") << ", " << edges.size() / 2
+             << " edges): max abs error " << max_error << "\n";
+    }
+    return report(found, expected, tolerance, worst, num_threads, [&](int64_t i) { return label[i]; });
+}
+
+// "expected_" before the file name (keeping its directory)
+string expected_name(const string &filename)
+{
+    size_t slash = filename.find_last_of('/');
+    size_t start = slash == string::npos ? 0 : slash + 1;
+    return filename.substr(0, start) + "expected_" + filename.substr(start);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Reads the program name and either the files to compare or "--engine ENGINE" from the terminal,
+    // optionally followed by the tolerances and the other options described at the top of this file
+    vector<string> files;
+    string engine;
+    Tolerance tolerance;
+    int worst = 5;
+    int num_threads = 0; // the OpenMP default
+    int num_graphs = 10;
+    int N = 1000;
+    uint64_t seed = 1;
+    try
+    {
+        for (int a = 1; a < argc; a++)
+        {
+            string option = argv[a];
+            bool has_value = a + 1 < argc;
+            if (option == "--abs" && has_value)
+            {
+                tolerance.abs = stod(argv[++a]);
+            }
+            else if (option == "--rel" && has_value)
+            {
+                tolerance.rel = stod(argv[++a]);
+            }
+            else if (option == "--ulp" && has_value)
+            {
+                tolerance.ulp = stoll(argv[++a]);
+            }
+            else if (option == "--worst" && has_value)
+            {
+                worst = stoi(argv[++a]);
+            }
+            else if (option == "--threads" && has_value)
+            {
+                num_threads = stoi(argv[++a]);
+            }
+            else if (option == "--engine" && has_value)
+            {
+                engine = argv[++a];
+            }
+            else if (option == "--graphs" && has_value)
+            {
+                num_graphs = stoi(argv[++a]);
+            }
+            else if (option == "--nodes" && has_value)
+            {
+                N = stoi(argv[++a]);
+            }
+            else if (option == "--seed" && has_value)
+            {
+                seed = stoull(argv[++a]);
+            }
+            else if (option.compare(0, 2, "--") != 0)
+            {
+                files.push_back(option);
+            }
+            else
+            {
+                throw invalid_argument("unknown option " + option);
+            }
+        }
+        if (engine.empty() ? (files.empty() || files.size() > 2) : (!files.empty() || num_graphs < 1 || N < 10))
+        {
+            throw invalid_argument("wrong arguments");
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << "\n"
+             << "Give in the command line a file name to compare with the expected one (expected_FILE by default):\n"
+             << "    RESULT [EXPECTED] [--abs A] [--rel R] [--ulp U] [--worst K] [--threads T]\n"
+             << "or an engine to compare with the sequential calculation on generated graphs:\n"
+             << "    --engine parallel|nodes|compressed|batches|sample:S|depth:K|top-k:K|threshold:T [--graphs G] [--nodes N (>= 10)] [--seed S] [tolerances]\n";
+        return 1;
+    }
+
+    try
+    {
+        if (!engine.empty())
+        {
+            bool match = validate_engine(engine, num_graphs, N, seed, num_threads, tolerance, worst);
+            cout << (match ? "The engine matches the sequential calculation.\n" : "The engine differs from the sequential calculation.\n");
+            return match ? 0 : 3;
+        }
+
+        string expected_file = files.size() == 2 ? files[1] : expected_name(files[0]);
+        vector<double> data = parse_numbers(files[0], num_threads);
+        vector<double> expected = parse_numbers(expected_file, num_threads);
+        if (data.size() != expected.size())
+        {
+            cerr << "Files have different number of elements (" << data.size() << " and " << expected.size() << ").\n";
+            return 3;
+        }
+        bool match = report(data, expected, tolerance, worst, num_threads, [](int64_t i) { return "element " + to_string(i); });
+        cout << (match ? "Files match!\n" : "Files differ.\n");
+        return match ? 0 : 3;
+    }
+    catch (const invalid_argument &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 2;
+    }
+}